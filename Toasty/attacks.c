@@ -0,0 +1,79 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "bitboard.h"
+#include "move.h"
+
+#define N_SAMPLES 4096
+
+typedef Bitboard (*AttackFunction)(int position, Bitboard blockers);
+
+static uint64_t seed = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t random_u64() {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return seed;
+}
+
+// Checks every blocker subset of every square, with random pieces outside the mask, against the
+// classical ray generator. Returns the number of wrong lookups.
+static int verify(const char* name, AttackFunction cardinal, AttackFunction intercardinal) {
+    int errors = 0;
+    for (int i = 0; i < 64; i++) {
+        for (int j = 0; j < (1 << ROOK_OFFSET[i]); j++) {
+            Bitboard blockers = get_blocker(ROOK_BLOCKER_MASK[i], j) | (random_u64() & ~ROOK_BLOCKER_MASK[i]);
+            errors += cardinal(i, blockers) != gen_cardinal_attacks_classical(i, blockers);
+        }
+        for (int j = 0; j < (1 << BISHOP_OFFSET[i]); j++) {
+            Bitboard blockers = get_blocker(BISHOP_BLOCKER_MASK[i], j) | (random_u64() & ~BISHOP_BLOCKER_MASK[i]);
+            errors += intercardinal(i, blockers) != gen_intercardinal_attacks_classical(i, blockers);
+        }
+    }
+    printf("%-6s %s\n", name, errors == 0 ? "matches classical attacks" : "DOES NOT match classical attacks");
+    return errors;
+}
+
+// Times rook and bishop lookups over a fixed set of random squares and sparse occupancies.
+static void benchmark(const char* name, AttackFunction cardinal, AttackFunction intercardinal, int* squares, Bitboard* occupancy, long lookups) {
+    Bitboard sum = 0;
+    clock_t start = clock();
+    for (long i = 0; i < lookups; i += 2) {
+        int k = i & (N_SAMPLES - 1);
+        sum ^= cardinal(squares[k], occupancy[k]);
+        sum ^= intercardinal(squares[k], occupancy[k]);
+    }
+    double seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+    double ns = seconds > 0 ? seconds * 1e9 / lookups : 0;
+    printf("%-6s %.2f ns/lookup (%.0f M lookups/s, checksum %llx)\n", name, ns, ns > 0 ? 1000 / ns : 0, sum);
+}
+
+// attacks [lookups]. Verifies both slider attack backends and compares their lookup speed.
+int main(int argc, char* args[]) {
+    long lookups = argc > 1 ? atol(args[1]) : 100000000;
+
+    init_magic_tables();
+    bool pext = attacks_backend == ATTACKS_PEXT;
+    printf("Selected backend: %s\n", pext ? "pext" : "magic");
+
+    int squares[N_SAMPLES];
+    Bitboard occupancy[N_SAMPLES];
+    for (int i = 0; i < N_SAMPLES; i++) {
+        squares[i] = random_u64() & 63;
+        occupancy[i] = random_u64() & random_u64();
+    }
+
+    int errors = verify("magic", gen_cardinal_attacks_magic, gen_intercardinal_attacks_magic);
+#if PEXT_ATTACKS
+    if (pext) errors += verify("pext", gen_cardinal_attacks_pext, gen_intercardinal_attacks_pext);
+#endif
+
+    benchmark("magic", gen_cardinal_attacks_magic, gen_intercardinal_attacks_magic, squares, occupancy, lookups);
+#if PEXT_ATTACKS
+    if (pext) benchmark("pext", gen_cardinal_attacks_pext, gen_intercardinal_attacks_pext, squares, occupancy, lookups);
+#endif
+
+    return errors > 0;
+}
\ No newline at end of file
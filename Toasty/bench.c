@@ -0,0 +1,103 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "bitboard.h"
+#include "board.h"
+#include "move.h"
+#include "search.h"
+#include "hashmap.h"
+#include "tinycthread.h"
+
+static const char* positions[] = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 10",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP2BPPP/R2QKB1R w KQ - 0 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+    "2r3k1/pp3ppp/2n1b3/3pP3/3P4/P1N2N2/1P3PPP/2R3K1 w - - 0 20",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 30",
+    "r1b2rk1/2q1bppp/p2ppn2/1p6/3BPP2/2N2B2/PPPQ2PP/R4R1K w - - 0 15",
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 40",
+};
+
+// Wall clock time since "start" in milliseconds. CPU time would add up the time of every thread.
+static long elapsed(struct timespec* start) {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+int main(int argc, char* args[]) {
+    int depth = argc > 1 ? atoi(args[1]) : 4;
+    int threads = argc > 2 ? atoi(args[2]) : 1;
+    int driver = argc > 3 && strcmp(args[3], "pvs") == 0 ? DRIVER_PVS : DRIVER_MTDF;
+    // With a time limit, the depth is only a maximum and the depth reached is reported instead.
+    int movetime = argc > 4 ? atoi(args[4]) : 0;
+
+    init_magic_tables();
+    init_reductions();
+    HashMap* hashmap = hashmap_alloc(20);
+
+    const int n_positions = sizeof(positions) / sizeof(positions[0]);
+    uint64_t total_nodes = 0;
+    uint64_t total_qnodes = 0;
+    int total_depth = 0;
+    PruneCounts pruned = {0};
+#if SEARCH_STATS
+    SearchStats stats = {0};
+#endif
+    long total = 0;
+
+    for (int i = 0; i < n_positions; i++) {
+        Board board;
+        board_from_fen(&board, positions[i]);
+        hashmap_clear(hashmap);
+
+        struct timespec start;
+        timespec_get(&start, TIME_UTC);
+
+        SearchLimits limits = {0};
+        limits.depth = depth;
+        limits.driver = driver;
+        limits.movetime = movetime;
+
+        bool stop = false;
+        SearchInfo info;
+        Move selected = {0, 0, 0};
+        int score = parallel_search(&board, hashmap, &stop, &limits, threads, &selected, &info);
+
+        long end = elapsed(&start);
+        printf("Position %d: %llu nodes (%ld ms), depth %d, score %d, move %d-%d\n", i + 1, info.nodes, end, info.depth, score, selected.from, selected.to);
+#if SEARCH_STATS
+        print_stats(stdout, &info.stats);
+        add_stats(&stats, &info.stats);
+#endif
+        total_nodes += info.nodes;
+        total_qnodes += info.qnodes;
+        total_depth += info.depth;
+        pruned.reverse_futility += info.pruned.reverse_futility;
+        pruned.futility += info.pruned.futility;
+        pruned.razoring += info.pruned.razoring;
+        pruned.late_move += info.pruned.late_move;
+        total += end;
+    }
+
+    uint64_t nps = total > 0 ? total_nodes * 1000 / total : 0;
+    printf("Total: %llu nodes at depth %d with %d threads using %s (%ld ms, %llu nodes/s)\n", total_nodes, depth, threads, driver == DRIVER_PVS ? "PVS" : "MTD(f)", total, nps);
+    printf("Quiescence: %llu nodes (%.1f%%)\n", total_qnodes, total_nodes > 0 ? 100.0 * total_qnodes / total_nodes : 0.0);
+    printf("Pruned: reverse futility %llu, futility %llu, razoring %llu, late move %llu\n", pruned.reverse_futility, pruned.futility, pruned.razoring, pruned.late_move);
+    if (movetime > 0) {
+        printf("Average depth reached in %d ms: %.2f\n", movetime, (double) total_depth / n_positions);
+    }
+#if SEARCH_STATS
+    printf("Magic lookups: %llu (%.2f per node)\n", stats.magic_lookups, total_nodes > 0 ? (double) stats.magic_lookups / total_nodes : 0.0);
+    printf("Move generation: %.1f ns per node, ordering: %.1f ns per node\n",
+        total_nodes > 0 ? (double) stats.gen_time / total_nodes : 0.0, total_nodes > 0 ? (double) stats.order_time / total_nodes : 0.0);
+#endif
+
+    hashmap_free(hashmap);
+
+    return 0;
+}
\ No newline at end of file
@@ -1,6 +1,11 @@
+#include <stddef.h>
 #include "bitboard.h"
 #include "move.h"
 
+#if PEXT_ATTACKS
+#include <cpuid.h>
+#endif
+
 Bitboard get_blocker(Bitboard mask, int square) {
     Bitboard blockers = 0ULL;
     int bits = COUNT(mask);
@@ -17,6 +22,8 @@ Bitboard get_blocker(Bitboard mask, int square) {
 void init_magic_tables() {
     init_rook_table();
     init_bishop_table();
+    init_line_tables();
+    set_attacks_backend(pext_supported() ? ATTACKS_PEXT : ATTACKS_MAGIC);
 }
 
 void init_rook_table() {
@@ -39,6 +46,71 @@ void init_bishop_table() {
     }
 }
 
+// PEXT of the blockers through the mask gives the same index as "get_blocker" takes, so each square's
+// attacks are packed back to back with no unused entries.
+void init_pext_tables() {
+    Bitboard* rook = ROOK_PEXT_TABLE;
+    Bitboard* bishop = BISHOP_PEXT_TABLE;
+    for (int i = 0; i < 64; i++) {
+        ROOK_PEXT[i] = rook;
+        for (int j = 0; j < (1 << ROOK_OFFSET[i]); j++) {
+            rook[j] = gen_cardinal_attacks_classical(i, get_blocker(ROOK_BLOCKER_MASK[i], j));
+        }
+        rook += 1 << ROOK_OFFSET[i];
+
+        BISHOP_PEXT[i] = bishop;
+        for (int j = 0; j < (1 << BISHOP_OFFSET[i]); j++) {
+            bishop[j] = gen_intercardinal_attacks_classical(i, get_blocker(BISHOP_BLOCKER_MASK[i], j));
+        }
+        bishop += 1 << BISHOP_OFFSET[i];
+    }
+}
+
+// Whether the processor has a fast PEXT instruction. AMD processors before Zen 3 (family 0x19) implement
+// it in microcode at many times the cost of a magic multiplication, so they keep the magic backend.
+bool pext_supported() {
+#if PEXT_ATTACKS
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0, NULL) < 7) return false;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    if (!(ebx & bit_BMI2)) return false;
+
+    __cpuid(0, eax, ebx, ecx, edx);
+    bool amd = ebx == signature_AMD_ebx && ecx == signature_AMD_ecx && edx == signature_AMD_edx;
+    __cpuid(1, eax, ebx, ecx, edx);
+    int family = ((eax >> 8) & 0xF) + ((eax >> 20) & 0xFF);
+    return !amd || family >= 0x19;
+#else
+    return false;
+#endif
+}
+
+// Selects how slider attacks are looked up. Returns false, leaving the backend unchanged, if "backend"
+// is PEXT and the processor or the build does not support it.
+bool set_attacks_backend(int backend) {
+    if (backend == ATTACKS_PEXT) {
+        if (!pext_supported()) return false;
+        if (ROOK_PEXT[0] == NULL) init_pext_tables();
+    }
+    attacks_backend = backend;
+    return true;
+}
+
+void init_line_tables() {
+    for (int i = 0; i < 64; i++) {
+        for (int j = 0; j < 64; j++) {
+            Bitboard squares = (1ULL << i) | (1ULL << j);
+            if ((gen_cardinal_attacks(i, 0) & (1ULL << j)) != 0) {
+                LINE[i][j] = (gen_cardinal_attacks(i, 0) & gen_cardinal_attacks(j, 0)) | squares;
+                BETWEEN[i][j] = gen_cardinal_attacks(i, 1ULL << j) & gen_cardinal_attacks(j, 1ULL << i);
+            } else if ((gen_intercardinal_attacks(i, 0) & (1ULL << j)) != 0) {
+                LINE[i][j] = (gen_intercardinal_attacks(i, 0) & gen_intercardinal_attacks(j, 0)) | squares;
+                BETWEEN[i][j] = gen_intercardinal_attacks(i, 1ULL << j) & gen_intercardinal_attacks(j, 1ULL << i);
+            }
+        }
+    }
+}
+
 // All possible king moves for each square.
 const Bitboard KING_MOVES[64] = {
     0x302ULL, 0x705ULL, 0xe0aULL, 0x1c14ULL,
@@ -316,6 +388,19 @@ const Bitboard BISHOP_BLOCKER_MASK[64] = {
 Bitboard ROOK_TABLE[64][4096];
 Bitboard BISHOP_TABLE[64][512];
 
+// Dense PEXT attack tables, with a pointer to the start of each square's attacks.
+Bitboard ROOK_PEXT_TABLE[ROOK_PEXT_SIZE];
+Bitboard BISHOP_PEXT_TABLE[BISHOP_PEXT_SIZE];
+Bitboard* ROOK_PEXT[64];
+Bitboard* BISHOP_PEXT[64];
+
+int attacks_backend = ATTACKS_MAGIC;
+
+// Squares strictly between two squares sharing a rank, file or diagonal.
+Bitboard BETWEEN[64][64];
+// Full rank, file or diagonal through two squares, including both squares.
+Bitboard LINE[64][64];
+
 // Each 6-tuple represents:
 // 1. Kingside path (White: E1-G1, Black: E8-G8)
 // 2. Queenside path (White: E1-C1, Black: E8-C8)
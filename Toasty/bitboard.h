@@ -2,6 +2,7 @@
 #define BITBOARD_H_
 
 #include <stdint.h>
+#include <stdbool.h>
 
 typedef uint64_t Bitboard;
 
@@ -9,6 +10,26 @@ typedef uint64_t Bitboard;
 #define MSB(x) (63 - __builtin_clzll(x))
 #define COUNT(x) (__builtin_popcountll(x))
 
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+// Slider attacks are looked up with magic multiplication, or with PEXT into dense tables on x86-64
+// processors with fast BMI2. Compile with -DPEXT_ATTACKS=0 to leave out the PEXT backend.
+#ifndef PEXT_ATTACKS
+#if defined(__x86_64__) && defined(__GNUC__)
+#define PEXT_ATTACKS 1
+#else
+#define PEXT_ATTACKS 0
+#endif
+#endif
+
+#define ATTACKS_MAGIC 0
+#define ATTACKS_PEXT 1
+
+// Sum of 2^(relevant blockers) over all squares.
+#define ROOK_PEXT_SIZE 102400
+#define BISHOP_PEXT_SIZE 5248
+
 #define ADD_BIT(board, pos) ((board) |= (1ULL << (pos)))
 #define CLEAR_BIT(board, pos) ((board) &= ~(1ULL << (pos)))
 
@@ -121,6 +142,10 @@ Bitboard get_blocker(Bitboard mask, int square);
 void init_magic_tables();
 void init_rook_table();
 void init_bishop_table();
+void init_line_tables();
+void init_pext_tables();
+bool pext_supported();
+bool set_attacks_backend(int backend);
 
 extern const Bitboard KING_MOVES[64];
 extern const Bitboard KNIGHT_MOVES[64];
@@ -134,6 +159,13 @@ extern const Bitboard ROOK_BLOCKER_MASK[64];
 extern const Bitboard BISHOP_BLOCKER_MASK[64];
 extern Bitboard ROOK_TABLE[64][4096];
 extern Bitboard BISHOP_TABLE[64][512];
+extern Bitboard ROOK_PEXT_TABLE[ROOK_PEXT_SIZE];
+extern Bitboard BISHOP_PEXT_TABLE[BISHOP_PEXT_SIZE];
+extern Bitboard* ROOK_PEXT[64];
+extern Bitboard* BISHOP_PEXT[64];
+extern int attacks_backend;
+extern Bitboard BETWEEN[64][64];
+extern Bitboard LINE[64][64];
 extern const Bitboard CASTLING[2][6];
 
 #endif
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include <string.h>
+#include <stddef.h>
 #include "bitboard.h"
 #include "board.h"
 #include "move.h"
@@ -39,7 +40,7 @@ void board_from_fen(Board* board, const char* fen) {
     i++;
 
     // Active color.
-    board->active_color = fen[i++] == 'w' ? WHITE : BLACK;
+    if (fen[i++] == 'b') switch_ply(board);
     i++;
 
     // Castling.
@@ -57,9 +58,8 @@ void board_from_fen(Board* board, const char* fen) {
     if (fen[i] != '-') {
         int file = 7 - (fen[i++] - 'a');
         int rank = fen[i++] - '1';
-        board->en_passant = rank * 8 + file;
+        set_en_passant(board, rank * 8 + file);
     } else {
-        board->en_passant = 0;
         i++;
     }
     i++;
@@ -74,6 +74,10 @@ void board_from_fen(Board* board, const char* fen) {
     while (fen[i] != 0 && fen[i] != ' ') {
         board->full_moves = board->full_moves * 10 + (fen[i++] - '0');
     }
+
+    board->checkers = gen_checkers(board, LSB(get_pieces(board, KING, board->active_color)));
+
+    VERIFY_KEY(board);
 }
 
 void board_to_fen(Board* board, char* fen) {
@@ -150,6 +154,7 @@ void board_to_fen(Board* board, char* fen) {
 
 void switch_ply(Board* board) {
     board->active_color = OPPOSITE(board->active_color);
+    board->key ^= ZOBRIST_BLACK;
 }
 
 void board_clear(Board* board) {
@@ -158,27 +163,41 @@ void board_clear(Board* board) {
 
 // http://www.cse.yorku.ca/~oz/hash.html
 // https://stackoverflow.com/questions/7666509/hash-function-for-string
+// Used by the opening book. The search uses the Zobrist key stored in the board instead.
 uint64_t hash(Board *board) {
     char* ptr = (char*) board;
-    // Ignore half and full move count for hash.
-    uint8_t half_moves = board->half_moves;
-    uint8_t full_moves = board->full_moves;
-    board->half_moves = 0;
-    board->full_moves = 0;
 
     uint64_t hash = 525201411107845655ULL;
-    for (int i = 0; i < sizeof(Board); i++) {
-        hash ^= ptr[i];
+    for (size_t i = 0; i < offsetof(Board, key); i++) {
+        // Ignore half and full move count for hash.
+        char byte = i < offsetof(Board, half_moves) ? ptr[i] : 0;
+        hash ^= byte;
         hash *= 0x5bd1e9955bd1e995;
         hash ^= hash >> 47;
     }
 
-    board->half_moves = half_moves;
-    board->full_moves = full_moves;
-
     return hash;
 }
 
+// Computes the Zobrist key of the board from scratch.
+uint64_t zobrist(Board* board) {
+    uint64_t key = 0;
+
+    Bitboard pieces = get_all_pieces(board);
+    while (pieces != 0) {
+        int pos = LSB(pieces);
+        pieces &= pieces - 1;
+        key ^= ZOBRIST_PIECES[get_color(board, pos) & 1][board->positions[pos] - 1][pos];
+    }
+
+    key ^= ZOBRIST_CASTLE[0][board->castle[0]];
+    key ^= ZOBRIST_CASTLE[1][board->castle[1]];
+    key ^= ZOBRIST_EN_PASSANT[board->en_passant];
+    if (!WHITE_TO_MOVE(board)) key ^= ZOBRIST_BLACK;
+
+    return key;
+}
+
 Piece get_piece(Board* board, uint8_t index) {
     return board->positions[index];
 }
@@ -203,28 +222,47 @@ void add_piece(Board* board, Piece piece, Piece color, uint8_t index) {
     board->positions[index] = piece;
     ADD_BIT(board->state[color], index);
     ADD_BIT(board->state[piece], index);
+    board->key ^= ZOBRIST_PIECES[color & 1][piece - 1][index];
 }
 
 void remove_piece(Board* board, Piece piece, Piece color, uint8_t index) {
     board->positions[index] = 0;
     CLEAR_BIT(board->state[color], index);
     CLEAR_BIT(board->state[piece], index);
+    board->key ^= ZOBRIST_PIECES[color & 1][piece - 1][index];
+}
+
+void set_en_passant(Board* board, uint8_t index) {
+    board->key ^= ZOBRIST_EN_PASSANT[board->en_passant] ^ ZOBRIST_EN_PASSANT[index];
+    board->en_passant = index;
 }
 
 void add_castle_kingside(Board* board, Piece color) {
-    board->castle[color & 1] |= 0b01;
+    uint8_t* castle = &board->castle[color & 1];
+    board->key ^= ZOBRIST_CASTLE[color & 1][*castle];
+    *castle |= 0b01;
+    board->key ^= ZOBRIST_CASTLE[color & 1][*castle];
 }
 
 void add_castle_queenside(Board* board, Piece color) {
-    board->castle[color & 1] |= 0b10;
+    uint8_t* castle = &board->castle[color & 1];
+    board->key ^= ZOBRIST_CASTLE[color & 1][*castle];
+    *castle |= 0b10;
+    board->key ^= ZOBRIST_CASTLE[color & 1][*castle];
 }
 
 void remove_castle_kingside(Board* board, Piece color) {
-    board->castle[color & 1] &= 0b10;
+    uint8_t* castle = &board->castle[color & 1];
+    board->key ^= ZOBRIST_CASTLE[color & 1][*castle];
+    *castle &= 0b10;
+    board->key ^= ZOBRIST_CASTLE[color & 1][*castle];
 }
 
 void remove_castle_queenside(Board* board, Piece color) {
-    board->castle[color & 1] &= 0b01;
+    uint8_t* castle = &board->castle[color & 1];
+    board->key ^= ZOBRIST_CASTLE[color & 1][*castle];
+    *castle &= 0b01;
+    board->key ^= ZOBRIST_CASTLE[color & 1][*castle];
 }
 
 bool can_castle_kingside(Board* board, Piece color) {
@@ -243,14 +281,259 @@ bool can_castle(Board* board) {
     return *(uint16_t*)(board->castle) != 0;
 }
 
-bool is_legal(Board* board) {
-    Bitboard king = get_pieces(board, KING, OPPOSITE(board->active_color));
-    Bitboard attacks = gen_attacks(board);
-
-    return (king & attacks) == 0;
+bool is_in_check(Board* board) {
+    return board->checkers != 0;
 }
 
-bool is_in_check(Board* board) {
-    Bitboard king = get_pieces(board, KING, OPPOSITE(board->active_color));
-    return gen_checkers(board, LSB(king)) != 0;
-}
\ No newline at end of file
+// Zobrist keys for each piece type and square, indexed by [color][piece - 1][square].
+const uint64_t ZOBRIST_PIECES[2][6][64] = {
+    { // White
+        { // Pawns
+            0xc0e16b163a85a4dcULL, 0x890acd8dd443c47cULL, 0xb3889d8a6dc47761ULL, 0x6a0398e528f0ae6aULL,
+            0x48344ece48a855eULL, 0xf175cfea21871330ULL, 0x391ceef02702c2fdULL, 0x4baf8cac4784cb12ULL,
+            0x3547744583a3f88eULL, 0xd9cf2b15c6b6c90eULL, 0x961facc76d5fe21cULL, 0x94ab49d50f11f9ULL,
+            0xe3211e37bdbeb6dcULL, 0x62fe6c274ff3511aULL, 0x5ac30b329fdf0574ULL, 0x1450582c6b65b406ULL,
+            0x7a30fcc7888eb791ULL, 0x5540f5ba6a15576eULL, 0x16cef0559096d3e9ULL, 0x2cf8f14b06874899ULL,
+            0xc9c9263b6e2ce103ULL, 0xd6ff920b0a9faa6dULL, 0x53192697db998dc1ULL, 0x73ea9b9bc7cd18d7ULL,
+            0x102713f872c33fceULL, 0xf4183a0e5d2a033eULL, 0x71b63e307eebb517ULL, 0xda61f5713d036000ULL,
+            0x46eb7409ae691b21ULL, 0xb23ad691d6707698ULL, 0x67c8fe11d22fc4b9ULL, 0x7eb4661419481338ULL,
+            0x98077547fb070efcULL, 0x1ee63336c2e3a9a8ULL, 0xbc353656348c36f6ULL, 0xce3898cbf1bb1bd8ULL,
+            0x265b1c23c82915cbULL, 0xfd1948c91687e355ULL, 0xd976893961980ffaULL, 0x336e77a6288e4c34ULL,
+            0x16f8956d7b76d269ULL, 0xda7cd844690d4669ULL, 0x1e8cf85f253a581eULL, 0x3ea68129e923e53aULL,
+            0xa080a077c9e9fd79ULL, 0x4469a19c673c14cfULL, 0xbd5b9351b2d0963cULL, 0xb46a749cad9df6b7ULL,
+            0x7da714e59c7d362ULL, 0x393a84bb5af17618ULL, 0xb3ae08f3c86dfc0cULL, 0x642a350ed7c82c93ULL,
+            0x547bdec029cd3fa3ULL, 0x778debb21b67fc3dULL, 0xb1e26d886eaed22bULL, 0x49fb5996898a7303ULL,
+            0x5e245bcec3e007b3ULL, 0x1f6818e4a739f61bULL, 0xad694562d6313affULL, 0xded7c324e96e3a09ULL,
+            0xe181ef86a661cf8ULL, 0x675448d833ac146bULL, 0xf047e1b493d6b255ULL, 0xe3d9f8b33d92678cULL
+        },
+        { // Knights
+            0x62648db4d3b1b3acULL, 0x5e772e6b32ded778ULL, 0x6bc2ea32285bad33ULL, 0x298b58c7b2262c2dULL,
+            0x89a142e7a847c68fULL, 0x7b170d776f29a64ULL, 0x754b9d28182fd07fULL, 0x934990332438604cULL,
+            0xa1ab48a85cc22bbbULL, 0xff5aa2d675545595ULL, 0x32a5a207c5c3eed3ULL, 0xd9970e23aebb3d51ULL,
+            0xd9d01979fc161649ULL, 0x437a2ed7a4fca264ULL, 0x30fa485d263c4dd1ULL, 0xaab6790590cb5b06ULL,
+            0x65091913e11e2cfaULL, 0x51b90f06b259b46bULL, 0x8289d10138b1d6b4ULL, 0x88ae7e8730e361fbULL,
+            0x833a622304c447bULL, 0xe2e55431bf4b1b54ULL, 0xdde9371fc120d32fULL, 0x5751a8d978ce73ddULL,
+            0xbf1f19e0e1fbd33dULL, 0x75374f1247e3cdaaULL, 0x9f1ca64eb4d3ce97ULL, 0x38136f3a3d5ace59ULL,
+            0xd47963dbf7f8dc43ULL, 0xd87428ff43dd9d86ULL, 0x2607e8bece834053ULL, 0x3c7a84fa12044c87ULL,
+            0x8c7f4bfac5f7e4bbULL, 0xed4a244966996f87ULL, 0x36c97138af16e719ULL, 0x8d81534dedb7662ULL,
+            0xac7c55978241afc4ULL, 0xdf1b8863c9332ce7ULL, 0x620ee7f218ea0997ULL, 0x38d1df383ce89b65ULL,
+            0xe719097929758713ULL, 0x9ec6cd248c58ad3cULL, 0xf54bd98a78d9f340ULL, 0x6498bc6124519df3ULL,
+            0x198e656271e64fa2ULL, 0xa43fd5dd0d813097ULL, 0x35ad65fea929819aULL, 0x2f00139d2a8cd90cULL,
+            0x155f41d97478845cULL, 0x3f2b6a8cfea779b9ULL, 0x4b7264199d7c962aULL, 0xa26165f55b57273fULL,
+            0xb7a6f3f0ecf5b89fULL, 0x8e0692470e1ee509ULL, 0x23234da5964b213aULL, 0x6461d9c18fb4c2b9ULL,
+            0x9c44cac712b73113ULL, 0x93de0e8d937a2da0ULL, 0x88c84529e3843d70ULL, 0x70daad40227330ceULL,
+            0x7ab855c449ec8acaULL, 0xc8de7a81906c8be8ULL, 0x5f5627df47641ddaULL, 0xdd60bf81e2586cbcULL
+        },
+        { // Kings
+            0x3cfc1ba44eaf2468ULL, 0x405a9309613ad882ULL, 0x4de7eb21b0277f28ULL, 0x86e512678e4dd45aULL,
+            0xf1286efd6bdd066ULL, 0x1c8aca34c2fa6773ULL, 0x1da8e48b2342e347ULL, 0x1890dcd0a94893e7ULL,
+            0x2b1aaf97ef6b4dffULL, 0xb32b16249647a7ecULL, 0x9fb5f0bced31ea58ULL, 0x3d78f7907627c61fULL,
+            0x1841958c7d191f94ULL, 0xa18a85a96a78b19eULL, 0x631e9abbb0213210ULL, 0x3dab614952cc05a9ULL,
+            0x17020b874beabd6ULL, 0xfa59da85e751094cULL, 0x29cd811450b5412eULL, 0x8d15c850af2489a8ULL,
+            0x950b3bdd58d563a0ULL, 0x836cb8f306d51f7eULL, 0x4065efde02b744e8ULL, 0xb9baecb669369d99ULL,
+            0x7b378c9248d47dc4ULL, 0x4ddd25d48cdc6168ULL, 0xa732d6380105f470ULL, 0x75c8d0927bb9c613ULL,
+            0x6785a012497a2d75ULL, 0xffca85e4ac7617e9ULL, 0xc6f2129203f39492ULL, 0x3ed2bc376029332eULL,
+            0xd0dc8d146f7e2680ULL, 0x513f8ed97341b4a1ULL, 0x4324394cfa366d32ULL, 0x7cbea6ee7da29a4aULL,
+            0x69707125ac82ecfaULL, 0xdd4ba7a8ed6c0ef7ULL, 0x100210a42564a9efULL, 0xaf1101e77e76c1c2ULL,
+            0x140a33b32394451bULL, 0xce3748ebe86fd0f9ULL, 0x763b94236a3c95dcULL, 0xe82087dbe388ce4ULL,
+            0x8a3f991981c24d6eULL, 0x31b399f558c60586ULL, 0xf50ea2c64afdfe9bULL, 0x6c02449c992ff889ULL,
+            0x7914a6531aeeb744ULL, 0xb75f86f73f2f4ec2ULL, 0x1bdb24c7bd571df8ULL, 0x6e4e518ae8f033eULL,
+            0xffe622dab44f3689ULL, 0xf2792f1385db0e95ULL, 0x2aad6ff4838907b8ULL, 0xd649d2b9341accaULL,
+            0x2aef8ac693c156cdULL, 0xb86c9e57fa18942eULL, 0xe85e3cf930ed3877ULL, 0xb3fb466dd31f94a2ULL,
+            0xac8d03c007f25604ULL, 0xa9eec498626ff508ULL, 0xf47be033dda3f9b0ULL, 0xa4f748b538e6f27dULL
+        },
+        { // Bishops
+            0xc01bb10959d5e985ULL, 0x89079de7dda37d8fULL, 0xd7007ba815cc0658ULL, 0xc4da1bb45a7b871aULL,
+            0x98185ba52f9d9cd4ULL, 0x4242c91a500844e5ULL, 0x7965f1aa6863c5dULL, 0x359ccaad9aea599ULL,
+            0xe7a54bf05004eddbULL, 0x333aa1cd725ff5e8ULL, 0x94c18d8184570964ULL, 0xee0303af7e757a57ULL,
+            0xbbc38705003c82ecULL, 0xc57a6bbdbb7edfbdULL, 0xbaea4e697c235ee2ULL, 0x9f1ed9c9b4707ea2ULL,
+            0x3845a969b77941f0ULL, 0x1f02624c80d73ce6ULL, 0x4820b4e1649d1ddcULL, 0x77d1259b2f0be5fbULL,
+            0xa495f4fdba5cccddULL, 0x5ce421e295346c68ULL, 0xdfd63adc1c5bc74ULL, 0x570045b98cbc93e3ULL,
+            0x5b7317cd17a15f04ULL, 0x6defb13e4a48fa9cULL, 0x9d2540358539f109ULL, 0xdff1d3db7af0541bULL,
+            0xa786c0d906df090eULL, 0x9c8aa8553f5db609ULL, 0x2d5d59b48454ab11ULL, 0x73fbfbfd57360323ULL,
+            0xe045969a1fe274d6ULL, 0xb374b31ccc1c9668ULL, 0xee53c1d82d9ced9cULL, 0x2ee16f7445f3d27ULL,
+            0x43d17009acf06ed8ULL, 0xd17f5baf03dd6e26ULL, 0xbddf2289ed7719ffULL, 0xf9b980d54f117273ULL,
+            0xcdd05dc90b2c3b5bULL, 0xae6df7dd9d557455ULL, 0xa6a0e6779f5dfb3fULL, 0xd85269b48de6f619ULL,
+            0x43b0855155163e1cULL, 0x716aa342eaa75e67ULL, 0xf601d8d15e1709aeULL, 0x9ce1c4f19d6c405bULL,
+            0x8e5d480bf2121c70ULL, 0x5cd643cb24cbaa78ULL, 0x44ecfa2a75ca3a34ULL, 0x390f2eddea3099a2ULL,
+            0xdfea67149da0609fULL, 0xb734297101779a59ULL, 0xc3f3700cbb0afe9fULL, 0x403cae0119d1bb35ULL,
+            0x23853b00d0e1076bULL, 0x63dc284ae4cf5983ULL, 0x252721131cfe91aeULL, 0xdbe6d98b3113e9d6ULL,
+            0xf3f923744c247687ULL, 0x1ef9061730e4ab6ULL, 0x7f2a753307b3391cULL, 0xfd4cbb1b3007d376ULL
+        },
+        { // Rooks
+            0x315223d9955e5ff5ULL, 0x9915a56be2c7c7efULL, 0x3e66e9525daedf9bULL, 0x5d11e9f16513b85aULL,
+            0xb9b79be4728b3fbaULL, 0x8dde000229bfce70ULL, 0x4ae0c293a07e69a9ULL, 0x94d74f810022d14dULL,
+            0x9063c2a287a548f5ULL, 0xa79c546b893123c3ULL, 0x4b0cc086a202fa6eULL, 0xfda4753b37b8cfc8ULL,
+            0x9a7947688bbcb00eULL, 0xa7931073a8a31155ULL, 0xec498f00a737f5ULL, 0x4cfebf01dde734c8ULL,
+            0x2a5e3ca771fbccc0ULL, 0x8d9195afd8f5de1ULL, 0x2913abcd348b28aeULL, 0xcab29d3919ed1819ULL,
+            0x2f5dcc634a52ae24ULL, 0x6a3be2de50f91898ULL, 0x7ed2c8018f20e582ULL, 0xfad4c7dbec26e0faULL,
+            0x69235101ded80f96ULL, 0x461e9a30e37bc398ULL, 0x29e8ab8301ce1491ULL, 0x36307c9633b51218ULL,
+            0x5e389d310fdbdbe9ULL, 0x2c7d23fca04ce777ULL, 0x2fedc51f8f24dc84ULL, 0xf843237ba04c7012ULL,
+            0x4543a467add1219bULL, 0xbe62405a2e5d99e5ULL, 0x18ac5a941feed320ULL, 0x8fca36f289e7b37ULL,
+            0x1c767ef2f480e155ULL, 0x62f41ffb39427264ULL, 0x4f828174e7e2af16ULL, 0x2cbea0ed80d71c44ULL,
+            0x4de01be84f910689ULL, 0xcf943bad6971eb07ULL, 0x801ff69f5a935d58ULL, 0x514b2552372328adULL,
+            0x57076e08ea8d5191ULL, 0x33c8a7d019cc24c1ULL, 0x396cac2fc80b1befULL, 0x8093df832c27d2e4ULL,
+            0x43cb91f42cfab47bULL, 0x6461f1b745f52f04ULL, 0x7df79a9a45fcaa8aULL, 0x3df9a45162f6a9b0ULL,
+            0x7411631c379e11edULL, 0xa49c01ff694fafaeULL, 0xbcf2a9370930a2fdULL, 0x55ec561e98a13bc3ULL,
+            0x80336a27956defe8ULL, 0xfd04fabb59cdbbcfULL, 0x838d4dfd2d4e4a90ULL, 0xe388ebc3e8fe0aa9ULL,
+            0xdf84b7a62a059884ULL, 0xa711c0bb2c1c16b6ULL, 0x17a354343cab394aULL, 0x276d975ffb5282edULL
+        },
+        { // Queens
+            0xb5dfb9156c333dbeULL, 0xe09412e8490f7894ULL, 0x49e233995fdad754ULL, 0xde6a96429a8d460eULL,
+            0x3587bb0b724e8627ULL, 0x3d9ba89f097d8c6ULL, 0x481fb39ef3eb2597ULL, 0xb3da66a12a50ec7cULL,
+            0x9e1af18c7a871783ULL, 0x44f35de827275dd6ULL, 0xdcf3b06687b8f5c7ULL, 0x460b689bf9a7269ULL,
+            0x9e5e2cca9ccb2f6cULL, 0xcdd08d04d2e08efeULL, 0x480b59a4cc0f1b48ULL, 0x30cd0ef186da9523ULL,
+            0x42f98d7d85943f4eULL, 0x21180e3600921b75ULL, 0xe3c700a65d14ac45ULL, 0x2b112e28a30d983dULL,
+            0xab044a6a230b38c9ULL, 0x38d622b4be33d12eULL, 0xb9b836401b2c7721ULL, 0xb84cddb775e59d4aULL,
+            0x6f7fad4d94585190ULL, 0x3fb95dc0f7cea7b8ULL, 0xd4142da192071045ULL, 0x44892b6d5322c106ULL,
+            0xee0c5e00fdba6218ULL, 0x41537eda08128c07ULL, 0x1e7d67368967cdd2ULL, 0xe5f30704194bb235ULL,
+            0x1eca8df0e77fb7feULL, 0x7a8250498325f00dULL, 0x473fb4b17725626ULL, 0x4a931cec9bc51775ULL,
+            0x15b0dfb22a42f058ULL, 0xacfb94000deae33bULL, 0xffc3a855afc35448ULL, 0x3497c2113c7c65b8ULL,
+            0x26f1e716aa281d95ULL, 0x8915af03e93201ffULL, 0x74389e51380ce5c7ULL, 0x383d84f314142a83ULL,
+            0x329cb1d69f4d6e65ULL, 0xfac961b2835ef131ULL, 0x73e3b97b326355b3ULL, 0x38a136fd7925e924ULL,
+            0xbbcacb2a09a158e4ULL, 0x673a3e22aae230a0ULL, 0x974757cdbb172176ULL, 0xedad13f908c7e7f5ULL,
+            0xe78a88b621881673ULL, 0x9cdb1ab1c20b1c3cULL, 0xf78878d99a60758dULL, 0x35e6dea801ecf020ULL,
+            0x3bcd3a0af93d24cbULL, 0xaafc9a790266894fULL, 0xc416c0008d211798ULL, 0xbad0f7cf18a6e9daULL,
+            0xc96220ea69a955cfULL, 0x65d987b3368449d0ULL, 0x55fa14dc83a0fc38ULL, 0xa2cea3d36aa8dfbeULL
+        }
+    },
+    { // Black
+        { // Pawns
+            0x73c3e88d22517e1aULL, 0xb1f56944d7be8ba2ULL, 0xb2a8e498f7e3b6d4ULL, 0x312c1881c519f0a0ULL,
+            0xffeddfeccce42599ULL, 0x9cded16bf518fb80ULL, 0xfd2c6d09897a5b6fULL, 0x4c7d3fef0935380cULL,
+            0x326f82699f8f2c8dULL, 0xa24c8a67851ce3f2ULL, 0xfa18742a9446f17eULL, 0xcb42e22158c8f932ULL,
+            0x4f37e25252f555bbULL, 0xfaa5f032f247ec5ULL, 0x98109cfcfeed679eULL, 0x3e5ad7441138b2ecULL,
+            0xef2fbd0b43bb539eULL, 0xff73afddc462fbcfULL, 0xadc6e19b575d9beULL, 0xa819c921a20484a3ULL,
+            0xa5c798cb47697de0ULL, 0x8270046ce31dcdf7ULL, 0x3fccad4bd5844dacULL, 0xbed53038616708c5ULL,
+            0xebe13f7b79210f0dULL, 0x65ff727fe687581ULL, 0x6a1085091939a3b9ULL, 0x581c1600d1c1de5cULL,
+            0x5173b2362c9cb0beULL, 0x77d410b6b1f5a688ULL, 0x1d179ded1d003761ULL, 0x6536782328addcfeULL,
+            0xad974adb1e79925eULL, 0xa5002897d78d43eULL, 0xfb5efa2377ad1a07ULL, 0x43ea2d29d26e7ccaULL,
+            0xf52f8fcd57ac2f6cULL, 0x57dbfe018ae354d0ULL, 0xb3dbede89f2460f9ULL, 0xc1fe14f713e4704cULL,
+            0xc461be032bcad5aULL, 0x182da4ee7b6d5aa9ULL, 0x75434b7f1227e42bULL, 0x5b8d63618cdf4728ULL,
+            0x7a98cab9e4a14346ULL, 0xa94e97b5954b0c0aULL, 0x5f348b102c6bde9bULL, 0xda07c556064edbeaULL,
+            0xef4f89c7b4cd1742ULL, 0xc2a31129477f426bULL, 0x16de101a22979c5ULL, 0xdd46cd40d751c278ULL,
+            0xbcbb39e6d635cdc0ULL, 0x450090ccbb922b0aULL, 0x15798294ec134ee1ULL, 0x6e8da71155efe89dULL,
+            0x63d01f6e8ce56a87ULL, 0x1ed1960e4e31bb0dULL, 0x6c9abe2262dfce19ULL, 0x537e794578b9e538ULL,
+            0xd2cec6f1daac9305ULL, 0x28f72e1de02701d4ULL, 0x2b857eac90c23255ULL, 0xa0de210df5c35525ULL
+        },
+        { // Knights
+            0xa4fc7e9884cc2262ULL, 0x17f0c3003f88712cULL, 0xfda44d35648a5987ULL, 0x6ac44bd8626686f5ULL,
+            0xe2b6c3437985fbafULL, 0xc14850afb6b04c5cULL, 0x1798994597207a42ULL, 0x5c78bc8902ef0879ULL,
+            0x527a06fb26a28a18ULL, 0xef675cfa95fa4cc1ULL, 0xb1cbd05e4c3ac667ULL, 0xe1bd7c2520f088a1ULL,
+            0xd46169c997602d1cULL, 0xe1f10aa9578761adULL, 0xec824324e0d492e3ULL, 0x25d3a4d9114b074fULL,
+            0xc09d57cf18c9f5e0ULL, 0xb274a730bf49cc02ULL, 0xc377cf98a085919aULL, 0x1d555c7db2981918ULL,
+            0xd1fb048e9f6af8b8ULL, 0xf786db0e712f2ff3ULL, 0xbd939d40667b916cULL, 0x24f8dd779c8a45d6ULL,
+            0x2b45b2f584d1b166ULL, 0x24705107f8ce9626ULL, 0xcb1224913728eedeULL, 0xaf71d6eb3ef60790ULL,
+            0xb9c3b2f1081835e4ULL, 0x6c8e1c12f0f989eULL, 0x8386996eb5e47637ULL, 0x53fe9f26c7ee225aULL,
+            0xdfb23b0d26e40eceULL, 0xe6562988df0eb67dULL, 0xad72874292c69e08ULL, 0xf836c15de9adbef5ULL,
+            0x4f536ae98739ae6dULL, 0x3070e17868bad8e2ULL, 0x1ed18e4ccbf97eb8ULL, 0xf787dd1cf034a5d4ULL,
+            0x7d449824378cad9ULL, 0xfdb5181920f6013dULL, 0xeeb08971a6a98b4bULL, 0xdf20f0d3184d9f5dULL,
+            0x55ba4c0223f774e2ULL, 0x7c479f76c39490d5ULL, 0x75113e669bef9bd7ULL, 0x7a5ff851deb767e4ULL,
+            0x7dfffe435f07091ULL, 0xa3609e68be933d61ULL, 0x968e4bcd19e5ef62ULL, 0x9a4d771791e04addULL,
+            0x7e961f2c1b82161ULL, 0x49bfa68d90e35d3ULL, 0xdf35af68e3338fadULL, 0x581e68151181dbd4ULL,
+            0xaf2808a1b465e5a7ULL, 0x5e7f616c23d40481ULL, 0xc531727716ebb4fdULL, 0x1134413905a6686fULL,
+            0x9e15f3ef09058f2ULL, 0xd4e7bf9e6ae61f6cULL, 0x1ceb9962a11652d2ULL, 0xfd4d674344162c05ULL
+        },
+        { // Kings
+            0x5bc38760034406f9ULL, 0x747243b9447d7b06ULL, 0x256bed8d66e3e453ULL, 0xee07f045fd469918ULL,
+            0x6c03e40adda5e4c7ULL, 0x67207abd8b97da56ULL, 0x1560e00f5f15108cULL, 0x41a25462add0588dULL,
+            0x26d1ec44f1ec0a59ULL, 0xa52bb7aba88c759fULL, 0x763bd200676171f8ULL, 0x48cea3699e2c8dfULL,
+            0x82bbf7197ea54ff7ULL, 0xdeb6a44fed1d4f24ULL, 0xd87c2084d4483167ULL, 0x60516db74d83740fULL,
+            0x7d6baeb6c0aa7609ULL, 0xb091689303356b32ULL, 0x87a598c5f83dc1eeULL, 0x731d6d2c17570619ULL,
+            0x14a5c1cd1e3ac54bULL, 0x9475b301be8a0f8cULL, 0x79bff21bdf063936ULL, 0x3786af23d2f9708ULL,
+            0xa1897fe3cf49bd0aULL, 0x7920829a58ef22c5ULL, 0x6c82c78a2863b0e1ULL, 0xe4ac53eb27910580ULL,
+            0x215122faaf833b48ULL, 0x9c2cc8646c90b2e0ULL, 0xf4453314dd2bf8d9ULL, 0x278919ad84aea5c2ULL,
+            0xb5eecae7fa49400eULL, 0xd0692f2441958cb9ULL, 0x373ee2320a3c68f2ULL, 0xe4f83d59d3178d1fULL,
+            0x436b9dae9280797eULL, 0xfcae20fc3e362740ULL, 0x9a6c6255144e9a36ULL, 0x9ae5fba69041f9baULL,
+            0x5e4bb3e4efdbb2a9ULL, 0x74e74d8890445306ULL, 0x75f27e1aba5cd2d7ULL, 0x4c3b0bf31dabc4acULL,
+            0x965aed351216bc26ULL, 0xbd629f74edbe4a34ULL, 0x29b4bd761e35f5bbULL, 0x4368cd84fc606257ULL,
+            0x4b6c6f823ce04499ULL, 0x103044bd90951311ULL, 0xb0b9c4d27965418cULL, 0x488b28e3b6f38aa5ULL,
+            0x6de6a7e0a8c6939dULL, 0xfdea2542bbed865aULL, 0x12f1bae9ca00aa16ULL, 0x20759aabfedc4177ULL,
+            0xd9171f47d4ec919eULL, 0xa1667e57193d81c0ULL, 0x8cb9fa5f6fad4ebcULL, 0x2451940f700f3cacULL,
+            0xd7ba2533cd9d2578ULL, 0xc6f90af38b56d8d9ULL, 0x156536d09683f309ULL, 0x1a3698f15684f918ULL
+        },
+        { // Bishops
+            0xded0a6d387b5a830ULL, 0x6164f130d7810d16ULL, 0x96ef79f460139ad3ULL, 0x54bf131d1c976887ULL,
+            0xdfd1663bf0903da3ULL, 0xea60449d61a0dd03ULL, 0x1838e8f3cc46b494ULL, 0x988794e47d56e8ecULL,
+            0xb4ae4612c6b33e3ULL, 0x73dfe41015352c0bULL, 0xa962584ac444b647ULL, 0x562c5bbcc8b56adbULL,
+            0x25ec663329a0bd88ULL, 0xa5ecce44af86536aULL, 0x28f34282323755e2ULL, 0xfdeead65e2c26d8ULL,
+            0xa294643f5a8df0bbULL, 0x2eb0f5581e2c4a14ULL, 0xbd7ef8582a8aa4acULL, 0xe61db06b412f85edULL,
+            0xa6d89fe517ab065dULL, 0x9a211b67fceef746ULL, 0xa766519c5ce2548fULL, 0xe0ef58a67638238cULL,
+            0xff064ddda8326f94ULL, 0xa4f0554d2b56c47ULL, 0xd8fa0bb5894893f3ULL, 0x5edeceb3894a6212ULL,
+            0x9ed2456a0b7bd793ULL, 0xcec90919e3479c02ULL, 0x153a42b191074aa4ULL, 0x64faddc9815ca00fULL,
+            0x6e30dfc42c87a39bULL, 0x81454e793d242666ULL, 0xfc69f2c36b34e705ULL, 0x28100224cda2a635ULL,
+            0xb835c28bd2fe1a0ULL, 0xddc4fcc2aaf21c52ULL, 0x4087f7e27195a96cULL, 0x4ed39840d4cb73b3ULL,
+            0xa1e5d83afc8bab3aULL, 0x899080d2eede3f22ULL, 0x818d7825eeef4a56ULL, 0xaed6ba46bb681cbeULL,
+            0x8dae55e1096a7727ULL, 0xbf551b0ae7384232ULL, 0x4afa65f73b700354ULL, 0x6ff8e482614a4e0dULL,
+            0xd3a3704e579b3fe8ULL, 0xf3b3ba7af7927482ULL, 0x60760072609b4ffbULL, 0xf5927a35b3c78032ULL,
+            0x9f995e335f6bba1eULL, 0xe236f6ffae3afc03ULL, 0x466c4a32de25d75aULL, 0x95213575138d5299ULL,
+            0x847aeb6c0cd15cfULL, 0xe13fec49c06af0d1ULL, 0x9117e103bf977b84ULL, 0x14cf02d0ee9fb6ffULL,
+            0xb4080a9cf6a45263ULL, 0x786850a923685b81ULL, 0xc5374de3af45a0eeULL, 0xa8bf5c49d4b85fccULL
+        },
+        { // Rooks
+            0x618ca65df86ff964ULL, 0x1c0b55f1e977db74ULL, 0xacca5eb4ceb80c11ULL, 0x3e7133ee8ac37beeULL,
+            0x28447871b4be7373ULL, 0x2673e93b46351aaULL, 0xd9041a378fb91428ULL, 0xbd8157bcb2200551ULL,
+            0xbc351274781d0775ULL, 0x72a75823620c5983ULL, 0x38116c9cc90fdf6dULL, 0x20274b6a6051e8a7ULL,
+            0x96ee8822abc865abULL, 0x5fd2f519fff6cb6eULL, 0x45b5626a82a95559ULL, 0xc2f956e8317d4861ULL,
+            0x51082c9adae18262ULL, 0xed3ee8addd265f05ULL, 0xb41773fecd5dfd76ULL, 0x661615dbb92b2583ULL,
+            0xab25a880aa3140fULL, 0xefaf1165c558f7b0ULL, 0x1b6c50e3ca5030e9ULL, 0x8392dd09602db5bULL,
+            0xc793404e6b9ea91aULL, 0x9ebdf986b743a0eeULL, 0x5862faa6bc1cf929ULL, 0x1e98180aa945599bULL,
+            0x9d7a8bbbe7db8773ULL, 0x71e02aa1806e66e3ULL, 0x69e4a23f843b93d6ULL, 0xb8f264933d54c8ebULL,
+            0xbb22fffaf0340bd3ULL, 0xfef76d39696c1589ULL, 0x2eb85cf34d4a1d96ULL, 0xd51c305d110e650aULL,
+            0xef33cf45e69ea3ccULL, 0x5557ed81375e8ce6ULL, 0x140713036dcd153bULL, 0x7ac500d2c5a070faULL,
+            0xfad65acce0d4b95ULL, 0x4b7b406b6f82ee92ULL, 0x908126ee3937345bULL, 0xe51c93bd348c5eabULL,
+            0x8676002dfa305acULL, 0x31e36509301c27bcULL, 0xff34fd1cf88f101ULL, 0xd211e3c425bfbc99ULL,
+            0xd2d268eb8189d78bULL, 0x30f07f1e73fb5a00ULL, 0xc30dfa5e92aba935ULL, 0x1dedb15f39180a17ULL,
+            0xfe270532cfeb1227ULL, 0xdac5f6e28752599dULL, 0x62468c580c649907ULL, 0x680f49f18f2d32f3ULL,
+            0x85cdcb408b3a91adULL, 0x8fc19c8c9bbb8158ULL, 0x2839654208ba06d0ULL, 0x6dcdb997e466a3e3ULL,
+            0xe4285a7afde87502ULL, 0xf8a38caf04c6c20cULL, 0x14aa180d219a3bbULL, 0xd87cb0dec4b236fbULL
+        },
+        { // Queens
+            0xa5304d475af3e919ULL, 0x5a541e3b5e442248ULL, 0xaee410c158e2d754ULL, 0x9a600c742df064faULL,
+            0x33101e47642a48ceULL, 0xacf2732fd5fbec0aULL, 0x89f14f170666529ULL, 0x1311935b41f4af9dULL,
+            0x589db52f1c135e95ULL, 0x8a88d3ce46b1c22eULL, 0x603edbd4c5cd14e8ULL, 0x1a022bdf0ef17207ULL,
+            0xe07a88240f24a2d2ULL, 0xc3e7f9c8a65e1949ULL, 0xb68e2dbb18027f63ULL, 0x5e539b05e3946be3ULL,
+            0xbd6050750354bb02ULL, 0x6ea64a48f2753d76ULL, 0x4a3678d85579a6ecULL, 0xe09c1bfa86a5924dULL,
+            0x3e8771f62c0a868eULL, 0x8f96137ee18018cfULL, 0x7936e5f7e2c3d5f2ULL, 0xd3a8f51897c43fccULL,
+            0xc252192d5fa09142ULL, 0x1d7cbe6ecd4a7809ULL, 0x1cae8006803016caULL, 0x597bcd0c3b950581ULL,
+            0xe88d461989d815b8ULL, 0x1991c4db57dc09a8ULL, 0x534371c996d5a087ULL, 0x5b133173e24c46ffULL,
+            0xa4d9394d119867feULL, 0xbcb4d74624e1e000ULL, 0x515c9b83f3d8ebf3ULL, 0x14e317ba7f75c4a4ULL,
+            0x81a58f705d822e1cULL, 0x8244028086caf4c5ULL, 0x85aa6f34920c29a4ULL, 0x2febd8ca7e9cb7c4ULL,
+            0x9d1c0dc6b3537c73ULL, 0xdb6cc007e97900e6ULL, 0x7a5a8d8772c61dfeULL, 0xc41191fea7656c41ULL,
+            0xc5778b7e630b83a2ULL, 0x29c1b16f68807305ULL, 0x14a067cc964ca1f5ULL, 0x4fa4b4d1171f3d58ULL,
+            0x9d9abdaa2d066712ULL, 0x5957fed346a3fc22ULL, 0x3c786287e2a006dULL, 0x21756076260f79deULL,
+            0x6a80ab83e1be59b6ULL, 0xdd9236c4acc9c3eULL, 0x957a6c17e0cf9b38ULL, 0x9e0fff8f81af4cf9ULL,
+            0x1d95eb42eb855a17ULL, 0x88303c01b344212eULL, 0x92bff86dec073fcULL, 0x1e57b3ea04e5c233ULL,
+            0xf3b7fc513e7ff32eULL, 0x13119cd4ca78fa6eULL, 0xb78d4c34c09a7754ULL, 0x405d15a7a37516ddULL
+        }
+    }
+};
+
+// Zobrist keys for the castling rights of each color. No castling rights hash to 0.
+const uint64_t ZOBRIST_CASTLE[2][4] = {
+    {0x0ULL, 0x3ae19e9440df8556ULL, 0x4f82e935baaa86c5ULL, 0x42b57d51f4d459aULL}, // White
+    {0x0ULL, 0xd63cde9935cf1c4dULL, 0xe0764fd5e9e18a30ULL, 0x56254e4a352e8a5dULL} // Black
+};
+
+// Zobrist keys for en passant squares. Only squares on the 3rd and 6th ranks can be en passant squares.
+const uint64_t ZOBRIST_EN_PASSANT[64] = {
+    0x0ULL, 0x0ULL, 0x0ULL, 0x0ULL,
+    0x0ULL, 0x0ULL, 0x0ULL, 0x0ULL,
+    0x0ULL, 0x0ULL, 0x0ULL, 0x0ULL,
+    0x0ULL, 0x0ULL, 0x0ULL, 0x0ULL,
+    0x249894a15da79c01ULL, 0xd47f18efc38b6342ULL, 0x2dd475c8fa52c6e4ULL, 0xec22f900b510dd3fULL,
+    0xdf9d6f20592e47ffULL, 0xd3cd6dcd610bc7b9ULL, 0x73a0da47683ec22ULL, 0x8ad40b916aff03f1ULL,
+    0x0ULL, 0x0ULL, 0x0ULL, 0x0ULL,
+    0x0ULL, 0x0ULL, 0x0ULL, 0x0ULL,
+    0x0ULL, 0x0ULL, 0x0ULL, 0x0ULL,
+    0x0ULL, 0x0ULL, 0x0ULL, 0x0ULL,
+    0x14d689b976f45c3cULL, 0x23617d406ef61d5fULL, 0xf3b80e00f75e35cfULL, 0x423d77bdfce6ad76ULL,
+    0x91d468c6b85d8016ULL, 0xa00e0a6000fd01f5ULL, 0xad0dd69e8ea078a0ULL, 0xc9e0fc2897232aaeULL,
+    0x0ULL, 0x0ULL, 0x0ULL, 0x0ULL,
+    0x0ULL, 0x0ULL, 0x0ULL, 0x0ULL,
+    0x0ULL, 0x0ULL, 0x0ULL, 0x0ULL,
+    0x0ULL, 0x0ULL, 0x0ULL, 0x0ULL
+};
+
+// Zobrist key toggled when it is Black's turn to move.
+const uint64_t ZOBRIST_BLACK = 0xc27fe74b29ec9725ULL;
\ No newline at end of file
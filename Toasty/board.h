@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <assert.h>
 #include "bitboard.h"
 
 typedef uint8_t Piece;
@@ -24,6 +25,13 @@ typedef uint8_t Piece;
 #define WHITE_TO_MOVE(x) (((x)->active_color) == 0)
 #define IN_OPENING_BOOK(x) (((x)->full_moves) < 5)
 
+// Compile with -DDEBUG to check the incrementally updated Zobrist key against a full recompute.
+#ifdef DEBUG
+#define VERIFY_KEY(x) assert((x)->key == zobrist(x))
+#else
+#define VERIFY_KEY(x)
+#endif
+
 typedef struct {
     Piece positions[64]; // Stores locations of pieces.
     Bitboard state[8]; // One bitboard for each piece type and color.
@@ -32,6 +40,8 @@ typedef struct {
     uint8_t castle[2]; // First bit for Kingside, Second for Queenside.
     uint8_t half_moves;
     uint8_t full_moves;
+    uint64_t key; // Zobrist hash of the position, updated incrementally.
+    Bitboard checkers; // Enemy pieces giving check to the side to move, updated by make_move.
 } Board;
 
 void board_from_fen(Board* board, const char* fen);
@@ -41,6 +51,7 @@ void switch_ply(Board* board);
 
 void board_clear(Board* board);
 uint64_t hash(Board* board);
+uint64_t zobrist(Board* board);
 
 Piece get_piece(Board* board, uint8_t index);
 Piece get_color(Board* board, uint8_t index);
@@ -50,6 +61,7 @@ Bitboard get_all_pieces(Board* board);
 
 void add_piece(Board* board, Piece piece, Piece color, uint8_t index);
 void remove_piece(Board* board, Piece piece, Piece color, uint8_t index);
+void set_en_passant(Board* board, uint8_t index);
 
 void add_castle_kingside(Board* board, Piece color);
 void add_castle_queenside(Board* board, Piece color);
@@ -60,8 +72,12 @@ bool can_castle_queenside(Board* board, Piece color);
 bool can_castle_color(Board* board, Piece color);
 bool can_castle(Board* board);
 
-bool is_legal(Board* board);
 bool is_in_check(Board* board);
 bool is_stalemate(Board* board);
 
+extern const uint64_t ZOBRIST_PIECES[2][6][64];
+extern const uint64_t ZOBRIST_CASTLE[2][4];
+extern const uint64_t ZOBRIST_EN_PASSANT[64];
+extern const uint64_t ZOBRIST_BLACK;
+
 #endif
\ No newline at end of file
@@ -19,7 +19,8 @@ int evaluate(Board* board) {
     score += KING_SAFETY_BONUS * king_safety;
     score += mop_up_eval(board, material, active);
 
-    return active == WHITE ? score : -score;
+    // Scores are relative to the side to move, as the search is negamax.
+    return score;
 }
 
 int material_eval(Board* board, Piece color) {
@@ -26,7 +26,7 @@
 #define DEVELOPMENT_BONUS 10
 #define KING_SAFETY_BONUS 5
 
-#define CHECKMATE 131072
+#define CHECKMATE 32000
 
 extern const int PIECE_VALUES[7];
 extern const int PST[7][64];
@@ -5,37 +5,143 @@
 #include "hashmap.h"
 #include "move.h"
 
+_Static_assert(sizeof(Item) == sizeof(uint64_t), "an entry must fit in one atomic word");
+_Static_assert(sizeof(Bucket) == CACHE_LINE, "a bucket must fill exactly one cache line");
+
+// The table is shared between search threads without locks. Every entry is loaded and stored as one
+// word, so a concurrent write is either seen completely or not at all.
+static inline Item load_item(uint64_t* entry) {
+    uint64_t data = __atomic_load_n(entry, __ATOMIC_RELAXED);
+    Item item;
+    memcpy(&item, &data, sizeof(Item));
+    return item;
+}
+
+static inline void store_item(uint64_t* entry, Item* item) {
+    uint64_t data;
+    memcpy(&data, item, sizeof(Item));
+    __atomic_store_n(entry, data, __ATOMIC_RELAXED);
+}
+
+// Allocates a table of 2^size entries.
 HashMap* hashmap_alloc(int size) {
     HashMap* hashmap = (HashMap*) malloc(sizeof(HashMap));
-    hashmap->size = 1 << size;
-    hashmap->data = calloc(hashmap->size, sizeof(Item));
+    hashmap->size = MAX(1 << size, BUCKET_SIZE) / BUCKET_SIZE;
+    // Over-allocate so the buckets can be aligned to a cache line.
+    hashmap->memory = malloc(hashmap->size * sizeof(Bucket) + CACHE_LINE - 1);
+    hashmap->data = (Bucket*) (((uintptr_t) hashmap->memory + CACHE_LINE - 1) & ~(uintptr_t) (CACHE_LINE - 1));
+    hashmap_clear(hashmap);
     return hashmap;
 }
 
 void hashmap_free(HashMap* hashmap) {
-    free(hashmap->data);
+    free(hashmap->memory);
     free(hashmap);
 }
 
 void hashmap_clear(HashMap* hashmap) {
-    memset(hashmap->data, 0, hashmap->size * sizeof(Item));
+    memset(hashmap->data, 0, hashmap->size * sizeof(Bucket));
+    hashmap->generation = 0;
 }
 
-void hashmap_set(HashMap* hashmap, uint64_t key, int value, int depth, int flag) {
-    Item* item = &hashmap->data[(key >> KEY_OFFSET) & (hashmap->size - 1)];
-    if (depth >= item->depth) {
-        item->key = key;
-        item->value = value;
-        item->depth = depth;
-        item->flag = flag;
+// Marks entries from earlier searches as stale without discarding them.
+void hashmap_new_search(HashMap* hashmap) {
+    hashmap->generation += GENERATION_STEP;
+}
+
+// Permille of entries written or used in the current search, estimated from the first 1000 entries.
+int hashmap_hashfull(HashMap* hashmap) {
+    int n_buckets = MIN(hashmap->size, 1000 / BUCKET_SIZE);
+    int used = 0;
+    for (int i = 0; i < n_buckets; i++) {
+        for (int j = 0; j < BUCKET_SIZE; j++) {
+            Item item = load_item(&hashmap->data[i].entries[j]);
+            used += item.bound_generation != 0 && (item.bound_generation & ~BOUND_MASK) == hashmap->generation;
+        }
     }
+    return used * 1000 / (n_buckets * BUCKET_SIZE);
 }
 
-int hashmap_get(HashMap* hashmap, uint64_t key, int depth, int* ret) {
-    Item* item = &hashmap->data[(key >> KEY_OFFSET) & (hashmap->size - 1)];
-    if (depth <= item->depth && key == item->key) {
-        *ret = item->value;
-        return item->flag;
+// Lower values are replaced first. Deep entries are kept, unless they were not used in recent searches.
+static int replace_value(HashMap* hashmap, Item* item) {
+    if (item->bound_generation == 0) return INT32_MIN;
+    uint8_t age = (uint8_t) (hashmap->generation - (item->bound_generation & ~BOUND_MASK)) / GENERATION_STEP;
+    return item->depth - AGE_WEIGHT * age;
+}
+
+// Scores outside of the 16 bit range are only ever bounds, which remain valid when clamped.
+void hashmap_set(HashMap* hashmap, uint64_t key, int value, int depth, int flag, Move* move) {
+    Bucket* bucket = &hashmap->data[key & (hashmap->size - 1)];
+    uint16_t verify = key >> 48;
+    bool has_move = move != NULL && !IS_NULL_MOVE(*move);
+
+    int index = 0;
+    Item item = load_item(&bucket->entries[0]);
+    for (int i = 0; i < BUCKET_SIZE; i++) {
+        Item current = load_item(&bucket->entries[i]);
+        if (current.bound_generation != 0 && current.key == verify) {
+            // Keep a deeper result for the same position from the current search, but remember the new move.
+            if (depth < current.depth && (current.bound_generation & ~BOUND_MASK) == hashmap->generation && flag != BOUND_EXACT) {
+                if (has_move) {
+                    current.move = PACK_MOVE(*move);
+                    store_item(&bucket->entries[i], &current);
+                }
+                return;
+            }
+            index = i;
+            item = current;
+            break;
+        }
+        if (replace_value(hashmap, &current) < replace_value(hashmap, &item)) {
+            index = i;
+            item = current;
+        }
     }
-    return 0;
+
+    if (has_move) {
+        item.move = PACK_MOVE(*move);
+    } else if (item.bound_generation == 0 || item.key != verify) {
+        item.move = 0;
+    }
+    item.key = verify;
+    item.value = MAX(-SCORE_MAX, MIN(value, SCORE_MAX));
+    item.depth = MAX(INT8_MIN, MIN(depth, INT8_MAX));
+    item.bound_generation = hashmap->generation | flag;
+    store_item(&bucket->entries[index], &item);
 }
+
+// Returns the bound of the stored score if it was searched at least as deep as "depth".
+// The stored move is written to "move" whenever the position is found, regardless of depth. Only its
+// promoted piece flag is stored, the remaining flags must be restored with "infer_flags".
+int hashmap_get(HashMap* hashmap, uint64_t key, int depth, int* ret, Move* move) {
+    Bucket* bucket = &hashmap->data[key & (hashmap->size - 1)];
+    uint16_t verify = key >> 48;
+
+    for (int i = 0; i < BUCKET_SIZE; i++) {
+        uint64_t* entry = &bucket->entries[i];
+        Item item = load_item(entry);
+        if (item.bound_generation == 0 || item.key != verify) continue;
+
+        int flag = item.bound_generation & BOUND_MASK;
+        if ((item.bound_generation & ~BOUND_MASK) != hashmap->generation) {
+            // Mark the entry as used in this search, unless another thread has replaced it meanwhile.
+            uint64_t expected;
+            memcpy(&expected, &item, sizeof(Item));
+            Item refreshed = item;
+            refreshed.bound_generation = hashmap->generation | flag;
+            uint64_t desired;
+            memcpy(&desired, &refreshed, sizeof(Item));
+            __atomic_compare_exchange_n(entry, &expected, desired, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+        }
+
+        move->from = item.move & 0x3f;
+        move->to = (item.move >> 6) & 0x3f;
+        move->flags = ADD_PROMOTED_PIECE(item.move >> 12);
+        if (depth <= item.depth) {
+            *ret = item.value;
+            return flag;
+        }
+        return 0;
+    }
+    return 0;
+}
\ No newline at end of file
@@ -3,30 +3,57 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "move.h"
 
 #define BOUND_EXACT 1
 #define BOUND_UPPER 2
 #define BOUND_LOWER 3
 
-#define KEY_OFFSET 20
+#define CACHE_LINE 64
+#define BUCKET_SIZE 8
 
+// Entries store the generation above the two bound bits.
+#define BOUND_MASK 0x3
+#define GENERATION_STEP 4
+
+// Depth an entry loses against replacement for every search it was not used in.
+#define AGE_WEIGHT 8
+
+#define SCORE_MAX INT16_MAX
+
+// Move packing: 6 bits for the source square, 6 for the destination and 3 for the promoted piece.
+// All other flags are recovered from the board with "infer_flags".
+#define PACK_MOVE(x) ((uint16_t) ((x).from | (x).to << 6 | PROMOTED_PIECE((x).flags) << 12))
+
+// Decoded form of a table entry. Entries are stored as a single 64-bit word that is only read and
+// written atomically, so threads sharing the table never see an entry that is half written.
 typedef struct {
-    uint64_t key;
-    int value;
-    int depth;
-    int flag;
+    uint16_t key; // Upper 16 bits of the Zobrist key. The lower bits select the bucket.
+    uint16_t move; // Best move found, or the move that caused a beta cutoff.
+    int16_t value;
+    int8_t depth;
+    uint8_t bound_generation; // Bound in the low bits, search generation above. Empty entries are 0.
 } Item;
 
+// Entries sharing a cache line, so a probe touches memory only once.
+typedef struct {
+    uint64_t entries[BUCKET_SIZE];
+} Bucket;
+
 typedef struct {
-    int size;
-    Item* data;
+    int size; // Number of buckets.
+    Bucket* data;
+    void* memory; // Unaligned allocation backing "data".
+    uint8_t generation; // Multiple of GENERATION_STEP.
 } HashMap;
 
 HashMap* hashmap_alloc(int size);
 void hashmap_free(HashMap* hashmap);
 void hashmap_clear(HashMap* hashmap);
+void hashmap_new_search(HashMap* hashmap);
+int hashmap_hashfull(HashMap* hashmap);
 
-void hashmap_set(HashMap* hashmap, uint64_t key, int value, int depth, int flag);
-int hashmap_get(HashMap* hashmap, uint64_t key, int depth, int* ret);
+void hashmap_set(HashMap* hashmap, uint64_t key, int value, int depth, int flag, Move* move);
+int hashmap_get(HashMap* hashmap, uint64_t key, int depth, int* ret, Move* move);
 
 #endif
\ No newline at end of file
@@ -1,10 +1,19 @@
 #include <stdbool.h>
+#include <stddef.h>
 #include "bitboard.h"
 #include "board.h"
 #include "move.h"
 #include "evaluate.h"
 
-int score_move(Board* board, Move* move) {
+#if PEXT_ATTACKS
+#include <immintrin.h>
+#endif
+
+#if SEARCH_STATS
+_Thread_local uint64_t magic_lookups = 0;
+#endif
+
+int score_move(Board* board, Move* move, PositionInfo* info) {
     Piece src = board->positions[move->from];
     Piece dst = board->positions[move->to];
 
@@ -15,15 +24,12 @@ int score_move(Board* board, Move* move) {
     score += (PIECE_VALUES[dst] * CAPTURE_BONUS - PIECE_VALUES[src]) * IS_CAPTURE(move->flags);
 
     if (src != PAWN) {
-        switch_ply(board);
-        Bitboard attacks = gen_attacks(board);
-        switch_ply(board);
         // Promote moving away from a piece currently attacked.
-        if (((1ULL << move->from) & attacks) != 0) {
+        if (((1ULL << move->from) & info->threatened) != 0) {
             score += PIECE_VALUES[src];
         }
         // Penalize moving to an attacked spot.
-        if (((1ULL << move->to) & attacks) != 0) {
+        if (((1ULL << move->to) & info->danger[EMPTY]) != 0) {
             score -= CAPTURE_BONUS * PIECE_VALUES[src];
         }
     }
@@ -31,139 +37,127 @@ int score_move(Board* board, Move* move) {
     return score;
 }
 
-int extract_moves_pawns(Bitboard board, int8_t offset, Move* moves, int start, Flag flag) {
+SPECIALISED int extract_moves_pawns(PositionInfo* info, Bitboard board, int8_t offset, Move* moves, int start, Flag flag) {
     while (board != 0) {
         int pos = LSB(board);
         board &= board - 1;
+        int from = pos - offset;
+        // A pinned pawn may only move along the line between its king and the pinning piece.
+        if ((info->pinned & (1ULL << from)) != 0 && (LINE[info->king][from] & (1ULL << pos)) == 0) continue;
         Move* move = &moves[start++];
-        move->to = pos; move->from = pos - offset; move->flags = flag;
+        move->to = pos; move->from = from; move->flags = flag;
     }
 
     return start;
 }
 
-int extract_moves_pawns_promotions(Bitboard board, int8_t offset, Move* moves, int start, Flag flag) {
+SPECIALISED int extract_moves_pawns_promotions(PositionInfo* info, Bitboard board, int8_t offset, Move* moves, int start, Flag flag) {
     while (board != 0) {
         int pos = LSB(board);
         board &= board - 1;
+        int from = pos - offset;
+        if ((info->pinned & (1ULL << from)) != 0 && (LINE[info->king][from] & (1ULL << pos)) == 0) continue;
         Move* move;
         move = &moves[start++];
-        move->to = pos; move->from = pos - offset; move->flags = ADD_PROMOTED_PIECE(QUEEN) | flag;
+        move->to = pos; move->from = from; move->flags = ADD_PROMOTED_PIECE(QUEEN) | flag;
         move = &moves[start++];
-        move->to = pos; move->from = pos - offset; move->flags = ADD_PROMOTED_PIECE(KNIGHT) | flag;
+        move->to = pos; move->from = from; move->flags = ADD_PROMOTED_PIECE(KNIGHT) | flag;
         move = &moves[start++];
-        move->to = pos; move->from = pos - offset; move->flags = ADD_PROMOTED_PIECE(BISHOP) | flag;
+        move->to = pos; move->from = from; move->flags = ADD_PROMOTED_PIECE(BISHOP) | flag;
         move = &moves[start++];
-        move->to = pos; move->from = pos - offset; move->flags = ADD_PROMOTED_PIECE(ROOK) | flag;
+        move->to = pos; move->from = from; move->flags = ADD_PROMOTED_PIECE(ROOK) | flag;
     }
 
     return start;
 }
 
-int gen_pawn_pushes(Board* board, Move* moves, int index) {
-    Bitboard pawns = get_pieces(board, PAWN, board->active_color);
+SPECIALISED int gen_pawn_pushes(Board* board, PositionInfo* info, Move* moves, int index, Piece color) {
+    Bitboard pawns = get_pieces(board, PAWN, color);
     Bitboard empty = ~get_all_pieces(board);
 
-    Bitboard single_pushes, double_pushes;
-    int8_t offset;
-
-    if (WHITE_TO_MOVE(board)) {
-        single_pushes = ((pawns & ~RANK7) << 8) & empty;
-        double_pushes = ((single_pushes & RANK3) << 8) & empty;
-        offset = 8;
-    } else {
-        single_pushes = ((pawns & ~RANK2) >> 8) & empty;
-        double_pushes = ((single_pushes & RANK6) >> 8) & empty;
-        offset = -8;
-    }
+    Bitboard single_pushes = PAWN_SHIFT(pawns & ~PROMOTION_RANK(color), color, 8) & empty;
+    Bitboard double_pushes = PAWN_SHIFT(single_pushes & DOUBLE_PUSH_RANK(color), color, 8) & empty;
 
-    index = extract_moves_pawns(single_pushes, offset, moves, index, QUIET);
-    index = extract_moves_pawns(double_pushes, offset * 2, moves, index, PAWN_DOUBLE | QUIET);
+    index = extract_moves_pawns(info, single_pushes & info->evasions, PAWN_FORWARD(color), moves, index, QUIET);
+    index = extract_moves_pawns(info, double_pushes & info->evasions, PAWN_FORWARD(color) * 2, moves, index, PAWN_DOUBLE | QUIET);
 
     return index;
 }
 
-int gen_pawn_captures(Board* board, Move* moves, int index) {
-    Bitboard pawns = get_pieces(board, PAWN, board->active_color);
-    Bitboard enemies = get_pieces_color(board, OPPOSITE(board->active_color));
+SPECIALISED int gen_pawn_captures(Board* board, PositionInfo* info, Move* moves, int index, Piece color) {
+    Bitboard pawns = get_pieces(board, PAWN, color) & ~PROMOTION_RANK(color);
+    Bitboard enemies = get_pieces_color(board, OPPOSITE(color)) & info->evasions;
 
-    if (WHITE_TO_MOVE(board)) {
-        Bitboard valid_pawns = pawns & ~RANK7;
-        Bitboard capture_left = ((valid_pawns & ~FILEA) << 9) & enemies;
-        index = extract_moves_pawns(capture_left, 9, moves, index, CAPTURE);
-        Bitboard capture_right = ((valid_pawns & ~FILEH) << 7) & enemies;
-        index = extract_moves_pawns(capture_right, 7, moves, index, CAPTURE);
-    } else {
-        Bitboard valid_pawns = pawns & ~RANK2;
-        Bitboard capture_left = ((valid_pawns & ~FILEH) >> 9) & enemies;
-        index = extract_moves_pawns(capture_left, -9, moves, index, CAPTURE);
-        Bitboard capture_right = ((valid_pawns & ~FILEA) >> 7) & enemies;
-        index = extract_moves_pawns(capture_right, -7, moves, index, CAPTURE);
-    }
+    Bitboard capture_left = PAWN_SHIFT(pawns & ~PAWN_LEFT_EDGE(color), color, 9) & enemies;
+    index = extract_moves_pawns(info, capture_left, PAWN_LEFT(color), moves, index, CAPTURE);
+    Bitboard capture_right = PAWN_SHIFT(pawns & ~PAWN_RIGHT_EDGE(color), color, 7) & enemies;
+    index = extract_moves_pawns(info, capture_right, PAWN_RIGHT(color), moves, index, CAPTURE);
 
     return index;
 }
 
-int gen_pawn_promotions_quiets(Board* board, Move* moves, int index) {
-    Bitboard pawns = get_pieces(board, PAWN, board->active_color);
+SPECIALISED int gen_pawn_promotions_quiets(Board* board, PositionInfo* info, Move* moves, int index, Piece color) {
+    Bitboard pawns = get_pieces(board, PAWN, color);
     Bitboard empty = ~get_all_pieces(board);
 
-    Bitboard promotions;
-    int8_t offset;
-
-    if (WHITE_TO_MOVE(board)) {
-        promotions = ((pawns & RANK7) << 8) & empty;
-        offset = 8;
-    } else {
-        promotions = ((pawns & RANK2) >> 8) & empty;
-        offset = -8;
-    }
-
-    index = extract_moves_pawns_promotions(promotions, offset, moves, index, QUIET);
+    Bitboard promotions = PAWN_SHIFT(pawns & PROMOTION_RANK(color), color, 8) & empty;
+    index = extract_moves_pawns_promotions(info, promotions & info->evasions, PAWN_FORWARD(color), moves, index, QUIET);
 
     return index;
 }
 
-int gen_pawn_promotions_captures(Board* board, Move* moves, int index) {
-    Bitboard pawns = get_pieces(board, PAWN, board->active_color);
-    Bitboard enemies = get_pieces_color(board, OPPOSITE(board->active_color));
+SPECIALISED int gen_pawn_promotions_captures(Board* board, PositionInfo* info, Move* moves, int index, Piece color) {
+    Bitboard pawns = get_pieces(board, PAWN, color) & PROMOTION_RANK(color);
+    Bitboard enemies = get_pieces_color(board, OPPOSITE(color)) & info->evasions;
 
-    if (WHITE_TO_MOVE(board)) {
-        Bitboard valid_pawns = pawns & RANK7;
-        Bitboard capture_left = ((valid_pawns & ~FILEA) << 9) & enemies;
-        index = extract_moves_pawns_promotions(capture_left, 9, moves, index, CAPTURE);
-        Bitboard capture_right = ((valid_pawns & ~FILEH) << 7) & enemies;
-        index = extract_moves_pawns_promotions(capture_right, 7, moves, index, CAPTURE);
-    } else {
-        Bitboard valid_pawns = pawns & RANK2;
-        Bitboard capture_left = ((valid_pawns & ~FILEH) >> 9) & enemies;
-        index = extract_moves_pawns_promotions(capture_left, -9, moves, index, CAPTURE);
-        Bitboard capture_right = ((valid_pawns & ~FILEA) >> 7) & enemies;
-        index = extract_moves_pawns_promotions(capture_right, -7, moves, index, CAPTURE);
-    }
+    Bitboard capture_left = PAWN_SHIFT(pawns & ~PAWN_LEFT_EDGE(color), color, 9) & enemies;
+    index = extract_moves_pawns_promotions(info, capture_left, PAWN_LEFT(color), moves, index, CAPTURE);
+    Bitboard capture_right = PAWN_SHIFT(pawns & ~PAWN_RIGHT_EDGE(color), color, 7) & enemies;
+    index = extract_moves_pawns_promotions(info, capture_right, PAWN_RIGHT(color), moves, index, CAPTURE);
 
     return index;
 }
 
-int gen_pawn_en_passant(Board* board, Move* moves, int index) {
+SPECIALISED int gen_pawn_en_passant(Board* board, PositionInfo* info, Move* moves, int index, Piece color) {
     if (board->en_passant == 0) return index;
 
-    Bitboard pawns = get_pieces(board, PAWN, board->active_color);
+    Bitboard pawns = get_pieces(board, PAWN, color);
     Bitboard en_passant = 1ULL << board->en_passant;
 
-    if (WHITE_TO_MOVE(board)) {
-        Bitboard capture_left = ((pawns & ~FILEA) << 9) & en_passant;
-        index = extract_moves_pawns(capture_left, 9, moves, index, CAPTURE | EN_PASSANT);
-        Bitboard capture_right = ((pawns & ~FILEH) << 7) & en_passant;
-        index = extract_moves_pawns(capture_right, 7, moves, index, CAPTURE | EN_PASSANT);
-    } else {
-        Bitboard capture_left = ((pawns & ~FILEH) >> 9) & en_passant;
-        index = extract_moves_pawns(capture_left, -9, moves, index, CAPTURE | EN_PASSANT);
-        Bitboard capture_right = ((pawns & ~FILEA) >> 7) & en_passant;
-        index = extract_moves_pawns(capture_right, -7, moves, index, CAPTURE | EN_PASSANT);
+    int start = index;
+    Bitboard capture_left = PAWN_SHIFT(pawns & ~PAWN_LEFT_EDGE(color), color, 9) & en_passant;
+    index = extract_moves_pawns(info, capture_left, PAWN_LEFT(color), moves, index, CAPTURE | EN_PASSANT);
+    Bitboard capture_right = PAWN_SHIFT(pawns & ~PAWN_RIGHT_EDGE(color), color, 7) & en_passant;
+    index = extract_moves_pawns(info, capture_right, PAWN_RIGHT(color), moves, index, CAPTURE | EN_PASSANT);
+
+    // Removing two pawns from the same rank can uncover a check the pin mask does not see,
+    // so each en passant capture is verified against the position after the capture.
+    int n_legal = start;
+    for (int i = start; i < index; i++) {
+        if (is_en_passant_legal(board, info, &moves[i], color)) {
+            moves[n_legal++] = moves[i];
+        }
     }
 
-    return index;
+    return n_legal;
+}
+
+SPECIALISED bool is_en_passant_legal(Board* board, PositionInfo* info, Move* move, Piece color) {
+    Piece inactive = OPPOSITE(color);
+    int captured = move->to - PAWN_FORWARD(color);
+
+    Bitboard blockers = get_all_pieces(board);
+    blockers ^= (1ULL << move->from) | (1ULL << captured) | (1ULL << move->to);
+
+    Bitboard cardinal = get_pieces(board, ROOK, inactive) | get_pieces(board, QUEEN, inactive);
+    Bitboard intercardinal = get_pieces(board, BISHOP, inactive) | get_pieces(board, QUEEN, inactive);
+
+    // Knight and pawn checks are only resolved if the checking pawn is the one being captured.
+    Bitboard leapers = info->checkers & ~(cardinal | intercardinal) & ~(1ULL << captured);
+    Bitboard sliders = (gen_cardinal_attacks(info->king, blockers) & cardinal) |
+                       (gen_intercardinal_attacks(info->king, blockers) & intercardinal);
+
+    return (leapers | sliders) == 0;
 }
 
 int extract_moves(Bitboard board, int8_t init, Move* moves, int start, Flag flag) {
@@ -177,95 +171,90 @@ int extract_moves(Bitboard board, int8_t init, Move* moves, int start, Flag flag
     return start;
 }
 
-int gen_knight_moves(Board* board, Move* moves, int index, bool captures_only) {
-    Bitboard knights = get_pieces(board, KNIGHT, board->active_color);
-    Bitboard empty = ~get_all_pieces(board);
-    Bitboard enemies = get_pieces_color(board, OPPOSITE(board->active_color));
+int gen_knight_moves(Board* board, PositionInfo* info, Move* moves, int index, Bitboard targets) {
+    // A pinned knight can never move without exposing its king.
+    Bitboard knights = get_pieces(board, KNIGHT, board->active_color) & ~info->pinned;
+    Bitboard empty = ~get_all_pieces(board) & targets;
+    Bitboard enemies = get_pieces_color(board, OPPOSITE(board->active_color)) & targets;
 
     while (knights != 0) {
         int pos = LSB(knights);
         knights &= knights - 1;
-        if (!captures_only) {
-            index = extract_moves(KNIGHT_MOVES[pos] & empty, pos, moves, index, QUIET);
-        }
-        index = extract_moves(KNIGHT_MOVES[pos] & enemies, pos, moves, index, CAPTURE);
+        index = extract_moves(info->piece_attacks[pos] & empty, pos, moves, index, QUIET);
+        index = extract_moves(info->piece_attacks[pos] & enemies, pos, moves, index, CAPTURE);
     }
 
     return index;
 }
 
-int gen_king_moves(Board* board, Move* moves, int index, bool captures_only) {
-    Bitboard king = get_pieces(board, KING, board->active_color);
-    Bitboard empty = ~get_all_pieces(board);
-    Bitboard enemies = get_pieces_color(board, OPPOSITE(board->active_color));
+int gen_king_moves(Board* board, PositionInfo* info, Move* moves, int index, Bitboard targets) {
+    Bitboard safe = targets & ~info->danger[EMPTY];
+    Bitboard empty = ~get_all_pieces(board) & safe;
+    Bitboard enemies = get_pieces_color(board, OPPOSITE(board->active_color)) & safe;
 
-    int pos = LSB(king);
-    if (!captures_only) {
-        index = extract_moves(KING_MOVES[pos] & empty, pos, moves, index, QUIET);
-    }
+    int pos = info->king;
+    index = extract_moves(KING_MOVES[pos] & empty, pos, moves, index, QUIET);
     index = extract_moves(KING_MOVES[pos] & enemies, pos, moves, index, CAPTURE);
 
     return index;
 }
 
-int gen_cardinal_moves(Board* board, Move* moves, int index, bool captures_only) {
+int gen_cardinal_moves(Board* board, PositionInfo* info, Move* moves, int index, Bitboard targets) {
     Piece color = board->active_color;
     Bitboard cardinal = get_pieces(board, ROOK, color) | get_pieces(board, QUEEN, color);
-    Bitboard us = get_pieces_color(board, color);
-    Bitboard enemies = get_pieces_color(board, OPPOSITE(color));
-    Bitboard empty = ~get_all_pieces(board);
+    Bitboard all = get_all_pieces(board);
+    Bitboard empty = ~all & targets;
+    Bitboard enemies = get_pieces_color(board, OPPOSITE(color)) & targets;
 
     while (cardinal != 0) {
         int pos = LSB(cardinal);
         cardinal &= cardinal - 1;
 
-        Bitboard attacks = gen_cardinal_attacks_magic(pos, ~empty);
-
-        if (!captures_only) {
-            index = extract_moves(attacks & empty, pos, moves, index, QUIET);
+        // Queens only keep their attacks along the rank and file here.
+        Bitboard attacks = info->piece_attacks[pos] & ((RANK1 << (pos & ~7)) | (FILEH << (pos & 7)));
+        if ((info->pinned & (1ULL << pos)) != 0) {
+            attacks &= LINE[info->king][pos];
         }
+
+        index = extract_moves(attacks & empty, pos, moves, index, QUIET);
         index = extract_moves(attacks & enemies, pos, moves, index, CAPTURE);
     }
 
     return index;
 }
 
-int gen_intercardinal_moves(Board* board, Move* moves, int index, bool captures_only) {
+int gen_intercardinal_moves(Board* board, PositionInfo* info, Move* moves, int index, Bitboard targets) {
     Piece color = board->active_color;
     Bitboard intercardinal = get_pieces(board, BISHOP, color) | get_pieces(board, QUEEN, color);
-    Bitboard us = get_pieces_color(board, color);
-    Bitboard enemies = get_pieces_color(board, OPPOSITE(color));
-    Bitboard empty = ~get_all_pieces(board);
+    Bitboard all = get_all_pieces(board);
+    Bitboard empty = ~all & targets;
+    Bitboard enemies = get_pieces_color(board, OPPOSITE(color)) & targets;
 
     while (intercardinal != 0) {
         int pos = LSB(intercardinal);
         intercardinal &= intercardinal - 1;
 
-        Bitboard attacks = gen_intercardinal_attacks_magic(pos, ~empty);
-
-        if (!captures_only) {
-            index = extract_moves(attacks & empty, pos, moves, index, QUIET);
+        // Queens only keep their attacks along the diagonals here.
+        Bitboard attacks = info->piece_attacks[pos] & ~((RANK1 << (pos & ~7)) | (FILEH << (pos & 7)));
+        if ((info->pinned & (1ULL << pos)) != 0) {
+            attacks &= LINE[info->king][pos];
         }
+
+        index = extract_moves(attacks & empty, pos, moves, index, QUIET);
         index = extract_moves(attacks & enemies, pos, moves, index, CAPTURE);
     }
 
     return index;
 }
 
-int gen_castle_moves(Board* board, Move* moves, int index) {
-    switch_ply(board);
-    Bitboard attacks = gen_attacks(board);
-    switch_ply(board);
-
-    Bitboard king = get_pieces(board, KING, board->active_color);
-    if ((king & attacks) == 0) { // If king is not in check.
+int gen_castle_moves(Board* board, PositionInfo* info, Move* moves, int index) {
+    if (info->checkers == 0) { // If king is not in check.
         uint8_t color = board->active_color & 1; // Maps White to 0, Black to 1.
 
-        Bitboard us = get_pieces_color(board, board->active_color);
-        Bitboard enemies = get_pieces_color(board, OPPOSITE(board->active_color));
+        Bitboard all = get_all_pieces(board);
 
         if (can_castle_kingside(board, board->active_color)) {
-            if ((CASTLING[color][KINGSIDE_PATH] & (attacks | us | enemies)) == 0) {
+            if ((CASTLING[color][KINGSIDE_PATH] & (info->danger[EMPTY] | all)) == 0) {
                 Move* move = &moves[index++];
                 move->to = CASTLING[color][KING_DST_KINGSIDE];
                 move->from = CASTLING[color][KING_POSITION];
@@ -273,8 +262,8 @@ int gen_castle_moves(Board* board, Move* moves, int index) {
             }
         }
         if (can_castle_queenside(board, board->active_color)) {
-            if ((CASTLING[color][QUEENSIDE_PATH] & (attacks | us | enemies)) == 0 &&
-                (CASTLING[color][QUEENSIDE_PATH_TO_ROOK] & (us | enemies)) == 0) {
+            if ((CASTLING[color][QUEENSIDE_PATH] & info->danger[EMPTY]) == 0 &&
+                (CASTLING[color][QUEENSIDE_PATH_TO_ROOK] & all) == 0) {
                 Move* move = &moves[index++];
                 move->to = CASTLING[color][KING_DST_QUEENSIDE];
                 move->from = CASTLING[color][KING_POSITION];
@@ -286,17 +275,8 @@ int gen_castle_moves(Board* board, Move* moves, int index) {
     return index;
 }
 
-Bitboard gen_pawn_attacks(Board* board) {
-    Bitboard attacks = 0;
-    Bitboard pawns = get_pieces(board, PAWN, board->active_color);
-    if (WHITE_TO_MOVE(board)) {
-        attacks |= (pawns & ~FILEA) << 9;
-        attacks |= (pawns & ~FILEH) << 7;
-    } else {
-        attacks |= (pawns & ~FILEH) >> 9;
-        attacks |= (pawns & ~FILEA) >> 7;
-    }
-    return attacks;
+SPECIALISED Bitboard gen_pawn_attacks(Bitboard pawns, Piece color) {
+    return PAWN_SHIFT(pawns & ~PAWN_LEFT_EDGE(color), color, 9) | PAWN_SHIFT(pawns & ~PAWN_RIGHT_EDGE(color), color, 7);
 }
 
 Bitboard gen_cardinal_attacks_classical(int position, Bitboard blockers) {
@@ -357,89 +337,326 @@ Bitboard gen_intercardinal_attacks_magic(int position, Bitboard blockers) {
     return BISHOP_TABLE[position][key];
 }
 
-Bitboard gen_attacks(Board* board) {
-    Bitboard attacks = 0;
+#if PEXT_ATTACKS
+// Only called once "set_attacks_backend" has checked that the processor has BMI2.
+__attribute__((target("bmi2"))) Bitboard gen_cardinal_attacks_pext(int position, Bitboard blockers) {
+    return ROOK_PEXT[position][_pext_u64(blockers, ROOK_BLOCKER_MASK[position])];
+}
 
-    Piece active = board->active_color;
-    Piece inactive = OPPOSITE(active);
-    Bitboard empty = ~get_all_pieces(board);
+__attribute__((target("bmi2"))) Bitboard gen_intercardinal_attacks_pext(int position, Bitboard blockers) {
+    return BISHOP_PEXT[position][_pext_u64(blockers, BISHOP_BLOCKER_MASK[position])];
+}
+#endif
+
+// Slider attacks from "position" through the backend chosen by "set_attacks_backend".
+Bitboard gen_cardinal_attacks(int position, Bitboard blockers) {
+    COUNT_LOOKUP();
+#if PEXT_ATTACKS
+    if (attacks_backend == ATTACKS_PEXT) return gen_cardinal_attacks_pext(position, blockers);
+#endif
+    return gen_cardinal_attacks_magic(position, blockers);
+}
 
-    // Pawn Attacks.
-    attacks |= gen_pawn_attacks(board);
+Bitboard gen_intercardinal_attacks(int position, Bitboard blockers) {
+    COUNT_LOOKUP();
+#if PEXT_ATTACKS
+    if (attacks_backend == ATTACKS_PEXT) return gen_intercardinal_attacks_pext(position, blockers);
+#endif
+    return gen_intercardinal_attacks_magic(position, blockers);
+}
+
+// Squares attacked by "color" per piece type, with "attacks[EMPTY]" holding all of them. If "piece_attacks"
+// is given, the attacks of each knight and slider are also stored by the square of the piece.
+void gen_piece_attacks(Board* board, Piece color, Bitboard blockers, Bitboard* attacks, Bitboard* piece_attacks) {
+    attacks[PAWN] = gen_pawn_attacks(get_pieces(board, PAWN, color), color);
+    attacks[KING] = KING_MOVES[LSB(get_pieces(board, KING, color))];
 
-    // Knight Attacks.
-    Bitboard knights = get_pieces(board, KNIGHT, active);
+    attacks[KNIGHT] = 0;
+    Bitboard knights = get_pieces(board, KNIGHT, color);
     while (knights != 0) {
         int pos = LSB(knights);
         knights &= knights - 1;
-        attacks |= KNIGHT_MOVES[pos];
+        attacks[KNIGHT] |= KNIGHT_MOVES[pos];
+        if (piece_attacks != NULL) piece_attacks[pos] = KNIGHT_MOVES[pos];
     }
 
-    // King Attacks.
-    Bitboard king = get_pieces(board, KING, active);
-    attacks |= KING_MOVES[LSB(king)];
+    attacks[BISHOP] = 0;
+    Bitboard bishops = get_pieces(board, BISHOP, color);
+    while (bishops != 0) {
+        int pos = LSB(bishops);
+        bishops &= bishops - 1;
+        Bitboard moves = gen_intercardinal_attacks(pos, blockers);
+        attacks[BISHOP] |= moves;
+        if (piece_attacks != NULL) piece_attacks[pos] = moves;
+    }
 
-    Bitboard rooks = get_pieces(board, ROOK, active);
-    Bitboard bishops = get_pieces(board, BISHOP, active);
-    Bitboard queens = get_pieces(board, QUEEN, active);
-    // Sliding Attacks.
-    Bitboard sliding_cardinal = rooks | queens;
-    while (sliding_cardinal != 0) {
-        int pos = LSB(sliding_cardinal);
-        sliding_cardinal &= sliding_cardinal - 1;
-        attacks |= gen_cardinal_attacks_magic(pos, ~empty);
+    attacks[ROOK] = 0;
+    Bitboard rooks = get_pieces(board, ROOK, color);
+    while (rooks != 0) {
+        int pos = LSB(rooks);
+        rooks &= rooks - 1;
+        Bitboard moves = gen_cardinal_attacks(pos, blockers);
+        attacks[ROOK] |= moves;
+        if (piece_attacks != NULL) piece_attacks[pos] = moves;
     }
-    Bitboard sliding_intercardinal = bishops | queens;
-    while (sliding_intercardinal != 0) {
-        int pos = LSB(sliding_intercardinal);
-        sliding_intercardinal &= sliding_intercardinal - 1;
-        attacks |= gen_intercardinal_attacks_magic(pos, ~empty);
+
+    attacks[QUEEN] = 0;
+    Bitboard queens = get_pieces(board, QUEEN, color);
+    while (queens != 0) {
+        int pos = LSB(queens);
+        queens &= queens - 1;
+        Bitboard moves = gen_cardinal_attacks(pos, blockers) | gen_intercardinal_attacks(pos, blockers);
+        attacks[QUEEN] |= moves;
+        if (piece_attacks != NULL) piece_attacks[pos] = moves;
     }
 
-    return attacks;
+    attacks[EMPTY] = attacks[PAWN] | attacks[KNIGHT] | attacks[KING] | attacks[BISHOP] | attacks[ROOK] | attacks[QUEEN];
+}
+
+void gen_position_info(Board* board, PositionInfo* info) {
+    Piece active = board->active_color;
+    Piece inactive = OPPOSITE(active);
+
+    Bitboard king = get_pieces(board, KING, active);
+    Bitboard us = get_pieces_color(board, active);
+    Bitboard enemies = get_pieces_color(board, inactive);
+    Bitboard all = us | enemies;
+
+    info->king = LSB(king);
+    info->checkers = board->checkers;
+
+    gen_piece_attacks(board, active, all, info->attacks, info->piece_attacks);
+    // The king is removed from the blockers so that squares behind it on a checking ray are not
+    // considered safe.
+    gen_piece_attacks(board, inactive, all & ~king, info->danger, NULL);
+    info->threatened = us & info->danger[EMPTY];
+
+    if (info->checkers == 0) {
+        info->evasions = ~0ULL;
+    } else if ((info->checkers & (info->checkers - 1)) == 0) {
+        // Single check: capture the checker or block the ray between it and the king.
+        info->evasions = info->checkers | BETWEEN[info->king][LSB(info->checkers)];
+    } else {
+        // Double check: only king moves are legal.
+        info->evasions = 0;
+    }
+
+    // Enemy sliders that would attack the king if our pieces were removed.
+    Bitboard cardinal = get_pieces(board, ROOK, inactive) | get_pieces(board, QUEEN, inactive);
+    Bitboard intercardinal = get_pieces(board, BISHOP, inactive) | get_pieces(board, QUEEN, inactive);
+    Bitboard pinners = (gen_cardinal_attacks(info->king, enemies) & cardinal) |
+                       (gen_intercardinal_attacks(info->king, enemies) & intercardinal);
+
+    info->pinned = 0;
+    while (pinners != 0) {
+        int pos = LSB(pinners);
+        pinners &= pinners - 1;
+        Bitboard between = BETWEEN[info->king][pos] & all;
+        // A single friendly piece between the slider and the king is pinned.
+        if ((between & (between - 1)) == 0) {
+            info->pinned |= between & us;
+        }
+    }
 }
 
 int gen_moves(Board* board, Move* moves) {
+    PositionInfo info;
+    gen_position_info(board, &info);
+
     int index = 0;
+    index = gen_capture_moves(board, &info, moves, index);
+    index = gen_quiet_moves(board, &info, moves, index);
+
+    return index;
+}
+
+int gen_captures(Board* board, Move* moves) {
+    PositionInfo info;
+    gen_position_info(board, &info);
+
+    return gen_capture_moves(board, &info, moves, 0);
+}
+
+// The side to move is dispatched on once here, so that the generators specialised on a color are
+// inlined with constant shifts and masks.
+int gen_capture_moves(Board* board, PositionInfo* info, Move* moves, int index) {
+    if (WHITE_TO_MOVE(board)) return gen_capture_moves_color(board, info, moves, index, WHITE);
+    return gen_capture_moves_color(board, info, moves, index, BLACK);
+}
+
+SPECIALISED int gen_capture_moves_color(Board* board, PositionInfo* info, Move* moves, int index, Piece color) {
+    Bitboard enemies = get_pieces_color(board, OPPOSITE(color));
+
+    index = gen_king_moves(board, info, moves, index, enemies);
+    // In double check, only the king can move.
+    if (info->evasions == 0) return index;
+
+    Bitboard targets = enemies & info->evasions;
 
-    index = gen_king_moves(board, moves, index, false);
+    index = gen_pawn_promotions_captures(board, info, moves, index, color);
+    index = gen_pawn_captures(board, info, moves, index, color);
 
-    index = gen_pawn_promotions_quiets(board, moves, index);
-    index = gen_pawn_promotions_captures(board, moves, index);
-    index = gen_pawn_captures(board, moves, index);
+    index = gen_knight_moves(board, info, moves, index, targets);
+    index = gen_cardinal_moves(board, info, moves, index, targets);
+    index = gen_intercardinal_moves(board, info, moves, index, targets);
 
-    index = gen_knight_moves(board, moves, index, false);
-    index = gen_cardinal_moves(board, moves, index, false);
-    index = gen_intercardinal_moves(board, moves, index, false);
+    index = gen_pawn_en_passant(board, info, moves, index, color);
 
-    index = gen_pawn_pushes(board, moves, index);
-    index = gen_pawn_en_passant(board, moves, index);
+    return index;
+}
+
+int gen_quiet_moves(Board* board, PositionInfo* info, Move* moves, int index) {
+    if (WHITE_TO_MOVE(board)) return gen_quiet_moves_color(board, info, moves, index, WHITE);
+    return gen_quiet_moves_color(board, info, moves, index, BLACK);
+}
+
+SPECIALISED int gen_quiet_moves_color(Board* board, PositionInfo* info, Move* moves, int index, Piece color) {
+    Bitboard empty = ~get_all_pieces(board);
 
-    index = filter_legal(board, moves, index);
+    index = gen_king_moves(board, info, moves, index, empty);
+    // In double check, only the king can move.
+    if (info->evasions == 0) return index;
 
-    // gen_castle_moves generates legal castling moves only.
-    if (can_castle_color(board, board->active_color)) {
-        index = gen_castle_moves(board, moves, index);
+    Bitboard targets = empty & info->evasions;
+
+    index = gen_pawn_promotions_quiets(board, info, moves, index, color);
+
+    index = gen_knight_moves(board, info, moves, index, targets);
+    index = gen_cardinal_moves(board, info, moves, index, targets);
+    index = gen_intercardinal_moves(board, info, moves, index, targets);
+
+    index = gen_pawn_pushes(board, info, moves, index, color);
+
+    if (can_castle_color(board, color)) {
+        index = gen_castle_moves(board, info, moves, index);
     }
 
     return index;
 }
 
-int gen_captures(Board* board, Move* moves) {
-    int index = 0;
+Flag infer_flags(Board* board, int from, int to, Piece promoted) {
+    Piece piece = board->positions[from];
+    Flag flags = board->positions[to] != EMPTY ? CAPTURE : QUIET;
+
+    if (piece == PAWN) {
+        int distance = ABS(to - from);
+        if (distance == 16) {
+            flags |= PAWN_DOUBLE;
+        } else if (distance != 8 && to == board->en_passant && board->en_passant != 0) {
+            flags |= CAPTURE | EN_PASSANT;
+        }
+        if (((1ULL << to) & (RANK1 | RANK8)) != 0) {
+            flags |= ADD_PROMOTED_PIECE(promoted);
+        }
+    } else if (piece == KING && ABS(to - from) == 2) {
+        flags |= to < from ? CASTLE_KINGSIDE : CASTLE_QUEENSIDE;
+    }
+
+    return flags;
+}
+
+bool is_legal_move(Board* board, PositionInfo* info, Move* move) {
+    if (WHITE_TO_MOVE(board)) return is_legal_move_color(board, info, move, WHITE);
+    return is_legal_move_color(board, info, move, BLACK);
+}
+
+SPECIALISED bool is_legal_move_color(Board* board, PositionInfo* info, Move* move, Piece color) {
+    int from = move->from;
+    int to = move->to;
+    Bitboard src = 1ULL << from;
+    Bitboard dst = 1ULL << to;
 
-    index = gen_king_moves(board, moves, index, true);
+    Bitboard us = get_pieces_color(board, color);
+    Bitboard all = get_all_pieces(board);
+
+    if (from == to || (us & src) == 0 || (us & dst) != 0) return false;
+
+    Piece piece = board->positions[from];
+    Piece promoted = PROMOTED_PIECE(move->flags);
+    if (piece == PAWN && ((dst & (RANK1 | RANK8)) != 0) != (promoted != EMPTY)) return false;
+    if (promoted == PAWN || promoted == KING || promoted > QUEEN) return false;
+    if (move->flags != infer_flags(board, from, to, promoted)) return false;
+
+    if (IS_CASTLE(move->flags)) {
+        Move castles[2];
+        int n_castles = gen_castle_moves(board, info, castles, 0);
+        for (int i = 0; i < n_castles; i++) {
+            if (castles[i].to == to && castles[i].flags == move->flags) return true;
+        }
+        return false;
+    }
+
+    if (piece == KING) {
+        return (KING_MOVES[from] & dst & ~info->danger[EMPTY]) != 0;
+    }
+
+    // Non-king moves must resolve any check and keep pinned pieces on their pin line.
+    if (IS_EN_PASSANT(move->flags)) {
+        return (gen_pawn_attacks(src, color) & dst) != 0 && is_en_passant_legal(board, info, move, color);
+    }
+    if ((dst & info->evasions) == 0) return false;
+    if ((info->pinned & src) != 0 && (LINE[info->king][from] & dst) == 0) return false;
 
-    index = gen_pawn_promotions_captures(board, moves, index);
-    index = gen_pawn_captures(board, moves, index);
+    switch (piece) {
+        case PAWN: {
+            if (IS_CAPTURE(move->flags)) {
+                return (gen_pawn_attacks(src, color) & dst) != 0;
+            }
+            int8_t forward = PAWN_FORWARD(color);
+            if (IS_DOUBLE_PUSH(move->flags)) {
+                return (src & PAWN_START_RANK(color)) != 0 && to == from + 2 * forward && (all & (1ULL << (from + forward))) == 0;
+            }
+            return to == from + forward;
+        }
+        case KNIGHT:
+        case BISHOP:
+        case ROOK:
+        case QUEEN: return (info->piece_attacks[from] & dst) != 0;
+    }
+
+    return false;
+}
+
+// Enemy pieces checking the side to move after "move" was made. Only the moved piece can give a direct
+// check, and only a slider on the line through the king and the square it left a discovered one. Both
+// are found from the LINE and BETWEEN tables, and a slider lookup is only needed when the square the
+// piece left uncovers a line with a matching enemy slider on it.
+Bitboard gen_move_checkers(Board* board, Move* move) {
+    int king = LSB(get_pieces(board, KING, board->active_color));
+    // Castling also moves a rook and en passant also removes a pawn, so both are checked in full.
+    if (IS_CASTLE(move->flags) || IS_EN_PASSANT(move->flags)) return gen_checkers(board, king);
+
+    Piece attacker = OPPOSITE(board->active_color);
+    Bitboard all = get_all_pieces(board);
+    int to = move->to;
+    Bitboard dst = 1ULL << to;
+    Bitboard checkers = 0;
+
+    // A slider on "to" checks if it shares an open line of its kind with the king.
+    bool open = LINE[king][to] != 0 && (BETWEEN[king][to] & all) == 0;
+    bool cardinal_line = king / 8 == to / 8 || king % 8 == to % 8;
+    switch (board->positions[to]) {
+        case PAWN: checkers = (gen_pawn_attacks(dst, attacker) & (1ULL << king)) != 0 ? dst : 0; break;
+        case KNIGHT: checkers = (KNIGHT_MOVES[to] & (1ULL << king)) != 0 ? dst : 0; break;
+        case BISHOP: checkers = open && !cardinal_line ? dst : 0; break;
+        case ROOK: checkers = open && cardinal_line ? dst : 0; break;
+        case QUEEN: checkers = open ? dst : 0; break;
+    }
 
-    index = gen_knight_moves(board, moves, index, true);
-    index = gen_cardinal_moves(board, moves, index, true);
-    index = gen_intercardinal_moves(board, moves, index, true);
+    int from = move->from;
+    Bitboard line = LINE[king][from];
+    if (line == 0 || (BETWEEN[king][from] & all) != 0) return checkers;
 
-    index = gen_pawn_en_passant(board, moves, index);
+    Bitboard queens = get_pieces(board, QUEEN, attacker);
+    if (king / 8 == from / 8 || king % 8 == from % 8) {
+        Bitboard cardinal = (get_pieces(board, ROOK, attacker) | queens) & line;
+        if (cardinal != 0) checkers |= gen_cardinal_attacks(king, all) & cardinal;
+    } else {
+        Bitboard intercardinal = (get_pieces(board, BISHOP, attacker) | queens) & line;
+        if (intercardinal != 0) checkers |= gen_intercardinal_attacks(king, all) & intercardinal;
+    }
 
-    return filter_legal(board, moves, index);
+    return checkers;
 }
 
 Bitboard gen_checkers(Board* board, int position) {
@@ -454,47 +671,99 @@ Bitboard gen_checkers(Board* board, int position) {
     // Knight Checks.
     checks |= KNIGHT_MOVES[position] & get_pieces(board, KNIGHT, inactive);
 
-    // Pawn Checks.
-    Bitboard pawns = get_pieces(board, PAWN, inactive);
-    if (WHITE_TO_MOVE(board)) {
-        checks |= ((piece & ~FILEA) << 9) & pawns;
-        checks |= ((piece & ~FILEH) << 7) & pawns;
-    } else {
-        checks |= ((piece & ~FILEH) >> 9) & pawns;
-        checks |= ((piece & ~FILEA) >> 7) & pawns;
-    }
+    // Pawn Checks, from the squares a pawn of the side to move would attack.
+    checks |= gen_pawn_attacks(piece, active) & get_pieces(board, PAWN, inactive);
 
     // Sliding Checks.
     Bitboard rooks = get_pieces(board, ROOK, inactive);
     Bitboard bishops = get_pieces(board, BISHOP, inactive);
     Bitboard queens = get_pieces(board, QUEEN, inactive);
     Bitboard all = get_all_pieces(board);
-    checks |= gen_cardinal_attacks_magic(position, all) & (rooks | queens);
-    checks |= gen_intercardinal_attacks_magic(position, all) & (bishops | queens);
+    checks |= gen_cardinal_attacks(position, all) & (rooks | queens);
+    checks |= gen_intercardinal_attacks(position, all) & (bishops | queens);
 
     return checks;
 }
 
-int filter_legal(Board* board, Move* moves, int size) {
-    const Board copy = *board;
-    int king_pos = LSB(get_pieces(board, KING, board->active_color));
+// Pieces of both colors attacking "position" when only the squares in "occupied" block sliding pieces.
+Bitboard gen_attackers(Board* board, int position, Bitboard occupied) {
+    Bitboard square = 1ULL << position;
+    Bitboard cardinal = board->state[ROOK] | board->state[QUEEN];
+    Bitboard intercardinal = board->state[BISHOP] | board->state[QUEEN];
+
+    return (gen_pawn_attacks(square, BLACK) & get_pieces(board, PAWN, WHITE)) |
+           (gen_pawn_attacks(square, WHITE) & get_pieces(board, PAWN, BLACK)) |
+           (KNIGHT_MOVES[position] & board->state[KNIGHT]) |
+           (KING_MOVES[position] & board->state[KING]) |
+           (gen_cardinal_attacks(position, occupied) & cardinal) |
+           (gen_intercardinal_attacks(position, occupied) & intercardinal);
+}
+
+// Static Exchange Evaluation: the material won or lost by "move" once both sides have made every
+// favorable capture on its destination square, always capturing with their least valuable piece.
+// Sliding pieces lined up behind a capturing piece join the exchange once it has moved.
+int see(Board* board, Move* move) {
+    static const Piece order[] = {PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING};
+
+    int to = move->to;
+    Piece side = board->active_color;
+    Piece piece = board->positions[move->from];
+    Bitboard occupied = get_all_pieces(board) & ~(1ULL << move->from);
+
+    int gain[32];
+    gain[0] = PIECE_VALUES[board->positions[to]];
+    if (IS_EN_PASSANT(move->flags)) {
+        gain[0] = PIECE_VALUES[PAWN];
+        occupied &= ~(1ULL << (side == WHITE ? to - 8 : to + 8));
+    }
+    if (IS_PROMOTION(move->flags)) {
+        piece = PROMOTED_PIECE(move->flags);
+        gain[0] += PIECE_VALUES[piece] - PIECE_VALUES[PAWN];
+    }
+
+    Bitboard cardinal = board->state[ROOK] | board->state[QUEEN];
+    Bitboard intercardinal = board->state[BISHOP] | board->state[QUEEN];
+    Bitboard attackers = gen_attackers(board, to, occupied) & occupied;
+
+    int depth = 0;
+    while (true) {
+        side = OPPOSITE(side);
+        Bitboard ours = attackers & board->state[side];
+        if (ours == 0) break;
+
+        Piece attacker = EMPTY;
+        Bitboard candidates = 0;
+        for (int i = 0; i < 6 && candidates == 0; i++) {
+            attacker = order[i];
+            candidates = ours & board->state[attacker];
+        }
+        // The king may only capture last, onto a square no longer defended.
+        if (attacker == KING && (attackers & board->state[OPPOSITE(side)]) != 0) break;
+
+        depth++;
+        gain[depth] = PIECE_VALUES[piece] - gain[depth - 1];
+        piece = attacker;
 
-    int n_legal = 0;
-    for (int i = 0; i < size; i++) {
-        Move* move = &moves[i];
-        int pos = board->positions[move->from] == KING ? move->to : king_pos;
-        make_move_cheap(board, move);
-        // If king is not in check after making the move, then it is legal.
-        if (gen_checkers(board, pos) == 0) {
-            moves[n_legal++] = *move;
+        occupied &= ~(candidates & -candidates);
+        if (attacker == PAWN || attacker == BISHOP || attacker == QUEEN) {
+            attackers |= gen_intercardinal_attacks(to, occupied) & intercardinal;
         }
-        *board = copy; // Undo move.
+        if (attacker == ROOK || attacker == QUEEN) {
+            attackers |= gen_cardinal_attacks(to, occupied) & cardinal;
+        }
+        attackers &= occupied;
     }
 
-    return n_legal;
+    // Each side may stop capturing whenever continuing would lose material.
+    while (depth > 0) {
+        if (-gain[depth] < gain[depth - 1]) gain[depth - 1] = -gain[depth];
+        depth--;
+    }
+
+    return gain[0];
 }
 
-void make_move(Board* board, Move* move) {
+Undo make_move(Board* board, Move* move) {
     uint8_t src = move->from;
     uint8_t dst = move->to;
 
@@ -506,6 +775,15 @@ void make_move(Board* board, Move* move) {
     Piece active = board->active_color;
     Piece inactive = OPPOSITE(active);
 
+    Undo undo;
+    undo.captured = dst_piece;
+    undo.en_passant = board->en_passant;
+    undo.castle[0] = board->castle[0];
+    undo.castle[1] = board->castle[1];
+    undo.half_moves = board->half_moves;
+    undo.key = board->key;
+    undo.checkers = board->checkers;
+
     if (src_piece == PAWN || IS_CAPTURE(flags)) {
         board->half_moves = 0;
     } else {
@@ -516,31 +794,21 @@ void make_move(Board* board, Move* move) {
         board->full_moves++;
     }
 
-    // If King moved and it wasn't a castle, then the player can no longer castle.
-    if (src_piece == KING && !IS_CASTLE(flags)) {
+    // If King moved, then the player can no longer castle.
+    if (src_piece == KING) {
         remove_castle_kingside(board, active);
         remove_castle_queenside(board, active);
     }
 
-    // If any of the rooks moved from one of the corners, then the player can no longer castle on that side.
-    if (src_piece == ROOK) {
-        if (src == H1 || src == H8) {
-            remove_castle_kingside(board, active);
-        } else if (src == A1 || src == A8) {
-            remove_castle_queenside(board, active);
-        }
+    // If a rook moves from or is captured on one of the corners, then that side can no longer be castled on.
+    if (can_castle(board)) {
+        if (src == H1 || dst == H1) remove_castle_kingside(board, WHITE);
+        if (src == A1 || dst == A1) remove_castle_queenside(board, WHITE);
+        if (src == H8 || dst == H8) remove_castle_kingside(board, BLACK);
+        if (src == A8 || dst == A8) remove_castle_queenside(board, BLACK);
     }
 
     if (IS_CAPTURE(flags)) {
-        // If a rook is captured, then remove the other players ability to castle on that side.
-        if (dst_piece == ROOK) {
-            if (dst == H1 || dst == H8) {
-                remove_castle_kingside(board, inactive);
-            } else if (dst == A1 || dst == A8) {
-                remove_castle_queenside(board, inactive);
-            }
-        }
-
         if (IS_EN_PASSANT(flags)) {
             int8_t offset = WHITE_TO_MOVE(board) ? -8 : 8;
             remove_piece(board, PAWN, inactive, dst + offset);
@@ -560,11 +828,11 @@ void make_move(Board* board, Move* move) {
 
     if (IS_DOUBLE_PUSH(flags)) {
         int8_t offset = WHITE_TO_MOVE(board) ? -8 : 8;
-        board->en_passant = dst + offset;
+        set_en_passant(board, dst + offset);
     } else {
         // If the right to capture en passant is not exercised immediately, it is subsequently lost.
         // If an en passant capture happens, then it is lost as well.
-        board->en_passant = 0;
+        set_en_passant(board, 0);
     }
 
     // If the move was a castle, move the rook to the corresponding position.
@@ -577,7 +845,6 @@ void make_move(Board* board, Move* move) {
                 remove_piece(board, ROOK, active, H8);
                 add_piece(board, ROOK, active, F8);
             }
-            remove_castle_kingside(board, active);
         } else if (IS_CASTLE_QUEENSIDE(flags)) {
             if (WHITE_TO_MOVE(board)) {
                 remove_piece(board, ROOK, active, A1);
@@ -586,47 +853,64 @@ void make_move(Board* board, Move* move) {
                 remove_piece(board, ROOK, active, A8);
                 add_piece(board, ROOK, active, D8);
             }
-            remove_castle_queenside(board, active);
         }
     }
 
-    board->active_color = inactive;
+    switch_ply(board);
+    board->checkers = gen_move_checkers(board, move);
+
+    VERIFY_KEY(board);
+    VERIFY_CHECKERS(board);
+
+    return undo;
 }
 
-void make_move_cheap(Board* board, Move* move) {
+void unmake_move(Board* board, Move* move, Undo* undo) {
     uint8_t src = move->from;
     uint8_t dst = move->to;
 
-    Piece src_piece = board->positions[src];
-    Piece dst_piece = board->positions[dst];
-
     Flag flags = move->flags;
 
-    Piece active = board->active_color;
-    Piece inactive = OPPOSITE(active);
+    Piece inactive = board->active_color;
+    Piece active = OPPOSITE(inactive);
+    board->active_color = active;
+
+    if (active == BLACK) {
+        board->full_moves--;
+    }
+
+    Piece dst_piece = board->positions[dst];
+    remove_piece(board, dst_piece, active, dst);
+    add_piece(board, IS_PROMOTION(flags) ? PAWN : dst_piece, active, src);
 
     if (IS_CAPTURE(flags)) {
         if (IS_EN_PASSANT(flags)) {
             int8_t offset = WHITE_TO_MOVE(board) ? -8 : 8;
-            remove_piece(board, PAWN, inactive, dst + offset);
+            add_piece(board, PAWN, inactive, dst + offset);
         } else {
-            remove_piece(board, dst_piece, inactive, dst);
+            add_piece(board, undo->captured, inactive, dst);
         }
     }
 
-    remove_piece(board, src_piece, active, src);
-
-    add_piece(board, IS_PROMOTION(flags) ? PROMOTED_PIECE(flags) : src_piece, active, dst);
-
-    // If the move was a castle, move the rook to the corresponding position.
+    // If the move was a castle, move the rook back to its corner.
     if (IS_CASTLE(flags)) {
         bool is_castle_kingside = IS_CASTLE_KINGSIDE(flags);
         if (WHITE_TO_MOVE(board)) {
-            remove_piece(board, ROOK, active, is_castle_kingside ? H1 : A1);
-            add_piece(board, ROOK, active, is_castle_kingside ? F1 : D1);
+            remove_piece(board, ROOK, active, is_castle_kingside ? F1 : D1);
+            add_piece(board, ROOK, active, is_castle_kingside ? H1 : A1);
         } else {
-            remove_piece(board, ROOK, active, is_castle_kingside ? H8 : A8);
-            add_piece(board, ROOK, active, is_castle_kingside ? F8 : D8);
+            remove_piece(board, ROOK, active, is_castle_kingside ? F8 : D8);
+            add_piece(board, ROOK, active, is_castle_kingside ? H8 : A8);
         }
     }
-}
+
+    board->en_passant = undo->en_passant;
+    board->castle[0] = undo->castle[0];
+    board->castle[1] = undo->castle[1];
+    board->half_moves = undo->half_moves;
+    board->key = undo->key;
+    board->checkers = undo->checkers;
+
+    VERIFY_KEY(board);
+    VERIFY_CHECKERS(board);
+}
\ No newline at end of file
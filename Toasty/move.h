@@ -36,44 +36,119 @@ typedef uint8_t Flag;
 
 #define MAX_MOVES 218
 
+// Pawn geometry of each color. In the generators specialised on a constant color these fold away to
+// plain shifts and masks. A pawn's left capture is towards the A file for White and the H file for Black.
+#define PAWN_SHIFT(b, color, n) ((color) == WHITE ? (b) << (n) : (b) >> (n))
+#define PAWN_FORWARD(color) ((color) == WHITE ? 8 : -8)
+#define PAWN_LEFT(color) ((color) == WHITE ? 9 : -9)
+#define PAWN_RIGHT(color) ((color) == WHITE ? 7 : -7)
+#define PAWN_LEFT_EDGE(color) ((color) == WHITE ? FILEA : FILEH)
+#define PAWN_RIGHT_EDGE(color) ((color) == WHITE ? FILEH : FILEA)
+#define PROMOTION_RANK(color) ((color) == WHITE ? RANK7 : RANK2)
+#define DOUBLE_PUSH_RANK(color) ((color) == WHITE ? RANK3 : RANK6)
+#define PAWN_START_RANK(color) ((color) == WHITE ? RANK2 : RANK7)
+
+// Functions taking the color as a parameter are always inlined, so that every call with a constant
+// color is compiled as a variant specialised for that color.
+#define SPECIALISED __attribute__((always_inline)) inline
+
+#define SAME_MOVE(a, b) ((a).from == (b).from && (a).to == (b).to && (a).flags == (b).flags)
+#define IS_NULL_MOVE(x) ((x).from == (x).to)
+
+// Magic table lookups made by the current thread, only counted when compiled with SEARCH_STATS=1.
+#if SEARCH_STATS
+extern _Thread_local uint64_t magic_lookups;
+#define COUNT_LOOKUP() (magic_lookups++)
+#else
+#define COUNT_LOOKUP() ((void) 0)
+#endif
+
+// Compile with -DDEBUG to check the checkers kept by make_move against a full recompute.
+#ifdef DEBUG
+#define VERIFY_CHECKERS(x) assert((x)->checkers == gen_checkers((x), LSB(get_pieces((x), KING, (x)->active_color))))
+#else
+#define VERIFY_CHECKERS(x)
+#endif
+
 typedef struct {
     uint8_t to, from;
     Flag flags;
 } Move;
 
-int score_move(Board* board, Move* move);
-
-int extract_moves_pawns(Bitboard board, int8_t offset, Move* moves, int start, Flag flag);
-int extract_moves_pawns_promotions(Bitboard board, int8_t offset, Move* moves, int start, Flag flag);
+// State that make_move cannot recover from the move alone. Returned by make_move and
+// passed back to unmake_move to restore the board.
+typedef struct {
+    Piece captured;
+    uint8_t en_passant;
+    uint8_t castle[2];
+    uint8_t half_moves;
+    uint64_t key;
+    Bitboard checkers;
+} Undo;
+
+// Attack, check and pin information of a position, computed once per node and shared by legal move
+// generation and move ordering. Attacks are indexed by piece type, index EMPTY holds all of them.
+typedef struct {
+    int king; // Position of the king of the side to move.
+    Bitboard checkers; // Enemy pieces giving check.
+    Bitboard pinned; // Friendly pieces pinned to the king.
+    Bitboard evasions; // Squares a non-king move must land on. All squares if not in check.
+    Bitboard attacks[7]; // Squares attacked by the side to move.
+    Bitboard danger[7]; // Squares attacked by the opponent, with the king removed from the board.
+    Bitboard threatened; // Friendly pieces attacked by the opponent.
+    Bitboard piece_attacks[64]; // Squares attacked by each knight, bishop, rook and queen of the side to move.
+} PositionInfo;
+
+int score_move(Board* board, Move* move, PositionInfo* info);
+
+int extract_moves_pawns(PositionInfo* info, Bitboard board, int8_t offset, Move* moves, int start, Flag flag);
+int extract_moves_pawns_promotions(PositionInfo* info, Bitboard board, int8_t offset, Move* moves, int start, Flag flag);
 int extract_moves(Bitboard board, int8_t offset, Move* moves, int start, Flag flag);
 
-int gen_pawn_pushes(Board* board, Move* moves, int index);
-int gen_pawn_captures(Board* board, Move* moves, int index);
-int gen_pawn_promotions_quiets(Board* board, Move* moves, int index);
-int gen_pawn_promotions_captures(Board* board, Move* moves, int index);
-int gen_pawn_en_passant(Board* board, Move* moves, int index);
+int gen_pawn_pushes(Board* board, PositionInfo* info, Move* moves, int index, Piece color);
+int gen_pawn_captures(Board* board, PositionInfo* info, Move* moves, int index, Piece color);
+int gen_pawn_promotions_quiets(Board* board, PositionInfo* info, Move* moves, int index, Piece color);
+int gen_pawn_promotions_captures(Board* board, PositionInfo* info, Move* moves, int index, Piece color);
+int gen_pawn_en_passant(Board* board, PositionInfo* info, Move* moves, int index, Piece color);
+bool is_en_passant_legal(Board* board, PositionInfo* info, Move* move, Piece color);
 
-int gen_knight_moves(Board* board, Move* moves, int index, bool captures_only);
-int gen_king_moves(Board* board, Move* moves, int index, bool captures_only);
+int gen_knight_moves(Board* board, PositionInfo* info, Move* moves, int index, Bitboard targets);
+int gen_king_moves(Board* board, PositionInfo* info, Move* moves, int index, Bitboard targets);
 
-int gen_cardinal_moves(Board* board, Move* moves, int index, bool captures_only);
-int gen_intercardinal_moves(Board* board, Move* moves, int index, bool captures_only);
+int gen_cardinal_moves(Board* board, PositionInfo* info, Move* moves, int index, Bitboard targets);
+int gen_intercardinal_moves(Board* board, PositionInfo* info, Move* moves, int index, Bitboard targets);
 
-int gen_castle_moves(Board* board, Move* moves, int index);
+int gen_castle_moves(Board* board, PositionInfo* info, Move* moves, int index);
 
-Bitboard gen_pawn_attacks(Board* board);
+Bitboard gen_pawn_attacks(Bitboard pawns, Piece color);
 Bitboard gen_cardinal_attacks_classical(int position, Bitboard blockers);
 Bitboard gen_intercardinal_attacks_classical(int position, Bitboard blockers);
 Bitboard gen_cardinal_attacks_magic(int position, Bitboard blockers);
 Bitboard gen_intercardinal_attacks_magic(int position, Bitboard blockers);
-Bitboard gen_attacks(Board* board);
-
+#if PEXT_ATTACKS
+Bitboard gen_cardinal_attacks_pext(int position, Bitboard blockers);
+Bitboard gen_intercardinal_attacks_pext(int position, Bitboard blockers);
+#endif
+Bitboard gen_cardinal_attacks(int position, Bitboard blockers);
+Bitboard gen_intercardinal_attacks(int position, Bitboard blockers);
+void gen_piece_attacks(Board* board, Piece color, Bitboard blockers, Bitboard* attacks, Bitboard* piece_attacks);
+
+void gen_position_info(Board* board, PositionInfo* info);
 int gen_moves(Board* board, Move* moves);
 int gen_captures(Board* board, Move* moves);
+int gen_capture_moves(Board* board, PositionInfo* info, Move* moves, int index);
+int gen_capture_moves_color(Board* board, PositionInfo* info, Move* moves, int index, Piece color);
+int gen_quiet_moves(Board* board, PositionInfo* info, Move* moves, int index);
+int gen_quiet_moves_color(Board* board, PositionInfo* info, Move* moves, int index, Piece color);
+Flag infer_flags(Board* board, int from, int to, Piece promoted);
+bool is_legal_move(Board* board, PositionInfo* info, Move* move);
+bool is_legal_move_color(Board* board, PositionInfo* info, Move* move, Piece color);
+Bitboard gen_move_checkers(Board* board, Move* move);
 Bitboard gen_checkers(Board* board, int position);
-int filter_legal(Board* board, Move* moves, int size);
+Bitboard gen_attackers(Board* board, int position, Bitboard occupied);
+int see(Board* board, Move* move);
 
-void make_move(Board* board, Move* move);
-void make_move_cheap(Board* board, Move* move);
+Undo make_move(Board* board, Move* move);
+void unmake_move(Board* board, Move* move, Undo* undo);
 
 #endif
\ No newline at end of file
@@ -1,25 +1,143 @@
 #include <stdint.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include "perft.h"
+#include "bitboard.h"
 #include "board.h"
 #include "move.h"
 
-int main(int argc, char* args[]) {
-    init_magic_tables();
+#define START_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+
+static const char* BACKEND_NAMES[] = {"magic", "pext"};
+
+// Positions with known node counts for "perft suite". The standard positions from the Chess Programming
+// Wiki come first, followed by en passant, castling, promotion and check edge cases.
+static const struct {
+    const char* fen;
+    int depth;
+    uint64_t nodes;
+} POSITIONS[] = {
+    {START_FEN, 5, 4865609},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624},
+    {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333},
+    {"r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1", 4, 422333},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487},
+    {"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594},
+    {"3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1", 6, 1134888},
+    {"8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1", 6, 1015133},
+    {"8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", 6, 1440467},
+    {"5k2/8/8/8/8/8/8/4K2R w K - 0 1", 6, 661072},
+    {"3k4/8/8/8/8/8/8/R3K3 w Q - 0 1", 6, 803711},
+    {"r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1", 4, 1274206},
+    {"r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1", 4, 1720476},
+    {"2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1", 6, 3821001},
+    {"8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1", 5, 1004658},
+    {"4k3/1P6/8/8/8/8/K7/8 w - - 0 1", 6, 217342},
+    {"8/P1k5/K7/8/8/8/8/8 w - - 0 1", 6, 92683},
+    {"K1k5/8/P7/8/8/8/8/8 w - - 0 1", 6, 2217},
+    {"8/k1P5/8/1K6/8/8/8/8 w - - 0 1", 7, 567584},
+    {"8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1", 4, 23527},
+};
+
+// Moves and milliseconds counted with each backend, for the totals of the suite.
+static uint64_t total_moves[2];
+static uint64_t total_time[2];
+
+// Counts "fen" to "depth" with each backend from "first" to "last" and returns the number of backends
+// whose count differs from "expected". An "expected" count of 0 only checks the backends against each other.
+static int count(const char* fen, int depth, uint64_t expected, int first, int last, bool bulk) {
     Board board;
-    for (int depth = 1; (depth <= args[1][0] - '0') && depth < 10; depth++) {
-        board_from_fen(&board, "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    uint64_t counts[2];
+    int errors = 0;
+    for (int backend = first; backend <= last; backend++) {
+        set_attacks_backend(backend);
+        board_from_fen(&board, fen);
 
         clock_t start = clock();
 
-        uint64_t moves = perft(&board, depth);
+        counts[backend] = bulk ? perft_bulk(&board, depth) : perft(&board, depth);
+
+        uint64_t end = (uint64_t) (clock() - start) * 1000 / CLOCKS_PER_SEC;
+        uint64_t nps = end > 0 ? counts[backend] * 1000 / end : 0;
+        printf("%llu moves at depth %d with %s (%llu ms, %llu nodes/s)\n", counts[backend], depth, BACKEND_NAMES[backend], end, nps);
+        total_moves[backend] += counts[backend];
+        total_time[backend] += end;
+
+        if (expected != 0 && counts[backend] != expected) {
+            printf("Expected %llu moves for %s\n", expected, fen);
+            errors++;
+        }
+    }
+    if (counts[first] != counts[last]) {
+        printf("Backends disagree at depth %d\n", depth);
+        errors++;
+    }
+    return errors;
+}
+
+// perft <depth> [options] [fen] counts the start position, or "fen", at every depth up to "depth".
+// perft suite [options] checks the positions above against their known counts and prints the total speed.
+// Options:
+//   magic, pext or both: the slider attack backend, by default picked from the processor. With "both",
+//                        every count is made with both backends and compared.
+//   bulk: count the moves generated at the last ply instead of making them, which times move generation
+//         with less of the cost of make_move.
+int main(int argc, char* args[]) {
+    if (argc < 2) {
+        printf("Usage: perft <depth> [magic|pext|both] [bulk] [fen]\n       perft suite [magic|pext|both] [bulk]\n");
+        return 1;
+    }
+
+    init_magic_tables();
+    int first = attacks_backend;
+    int last = attacks_backend;
+    bool bulk = false;
+    const char* fen = START_FEN;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(args[i], "both") == 0) {
+            first = ATTACKS_MAGIC;
+            last = ATTACKS_PEXT;
+        } else if (strcmp(args[i], "magic") == 0) {
+            first = last = ATTACKS_MAGIC;
+        } else if (strcmp(args[i], "pext") == 0) {
+            first = last = ATTACKS_PEXT;
+        } else if (strcmp(args[i], "bulk") == 0) {
+            bulk = true;
+        } else {
+            fen = args[i];
+        }
+    }
+    if (last == ATTACKS_PEXT && !set_attacks_backend(ATTACKS_PEXT)) {
+        printf("PEXT is not supported by this processor or build\n");
+        return 1;
+    }
 
-        long end = ((clock() - start) * 1000 / CLOCKS_PER_SEC);
-        printf("%llu moves at depth %d (%llu ms)\n", moves, depth, end);
+    int errors = 0;
+    if (strcmp(args[1], "suite") == 0) {
+        const int n_positions = sizeof(POSITIONS) / sizeof(POSITIONS[0]);
+        int failed = 0;
+        for (int i = 0; i < n_positions; i++) {
+            printf("Position %d: %s\n", i + 1, POSITIONS[i].fen);
+            int position_errors = count(POSITIONS[i].fen, POSITIONS[i].depth, POSITIONS[i].nodes, first, last, bulk);
+            failed += position_errors > 0;
+            errors += position_errors;
+        }
+        printf("Passed %d of %d positions\n", n_positions - failed, n_positions);
+        for (int backend = first; backend <= last; backend++) {
+            uint64_t nps = total_time[backend] > 0 ? total_moves[backend] * 1000 / total_time[backend] : 0;
+            printf("Total with %s: %llu moves (%llu ms, %llu nodes/s)\n", BACKEND_NAMES[backend], total_moves[backend], total_time[backend], nps);
+        }
+    } else {
+        for (int depth = 1; depth <= atoi(args[1]); depth++) {
+            errors += count(fen, depth, 0, first, last, bulk);
+        }
     }
 
-    return 0;
+    return errors > 0;
 }
 
 uint64_t perft(Board* board, int depth) {
@@ -28,12 +146,29 @@ uint64_t perft(Board* board, int depth) {
     Move moves[MAX_MOVES];
     int n_moves = gen_moves(board, moves);
 
-    const Board copy = *board;
     uint64_t nodes = 0;
     for (int i = 0; i < n_moves; i++) {
-        make_move(board, &moves[i]);
+        Undo undo = make_move(board, &moves[i]);
         nodes += perft(board, depth - 1);
-        *board = copy; // Undo move.
+        unmake_move(board, &moves[i], &undo);
+    }
+
+    return nodes;
+}
+
+// Perft which counts the legal moves at the last ply without making them.
+uint64_t perft_bulk(Board* board, int depth) {
+    if (depth == 0) return 1ULL;
+
+    Move moves[MAX_MOVES];
+    int n_moves = gen_moves(board, moves);
+    if (depth == 1) return n_moves;
+
+    uint64_t nodes = 0;
+    for (int i = 0; i < n_moves; i++) {
+        Undo undo = make_move(board, &moves[i]);
+        nodes += perft_bulk(board, depth - 1);
+        unmake_move(board, &moves[i], &undo);
     }
 
     return nodes;
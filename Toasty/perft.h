@@ -5,5 +5,6 @@
 #include "board.h"
 
 uint64_t perft(Board* board, int depth);
+uint64_t perft_bulk(Board* board, int depth);
 
 #endif
\ No newline at end of file
@@ -1,7 +1,8 @@
 #include <stdlib.h>
-#include <unistd.h>
+#include <string.h>
 #include <search.h>
 #include <limits.h>
+#include <math.h>
 #include <stdbool.h>
 #include <time.h>
 #include "tinycthread.h"
@@ -11,90 +12,546 @@
 #include "evaluate.h"
 #include "move.h"
 #include "hashmap.h"
+#include "timer.h"
 
-int timer(void* arg) {
-    sleep(SEARCH_TIMEOUT);
-    *(bool*) arg = true;
-    return 0;
-}
+// Depth reduction of late moves, indexed by the remaining depth and the number of the move.
+static uint8_t reductions[MAX_PLY][MAX_MOVES];
 
-void start_timer(bool* stop) {
-    thrd_t thrd;
-    thrd_create(&thrd, timer, stop);
+// Precomputes the late move reductions. Reductions grow with the logarithm of both the depth and the
+// move number, so late moves at high depths are reduced the most.
+void init_reductions() {
+    for (int depth = 1; depth < MAX_PLY; depth++) {
+        for (int n = 1; n < MAX_MOVES; n++) {
+            reductions[depth][n] = (uint8_t) (LMR_BASE + log(depth) * log(n) / LMR_DIVISOR);
+        }
+    }
 }
 
-bool select_move(Board* board, HashMap* hashmap, Move* move) {
+bool select_move(Board* board, HashMap* hashmap, Move* move, SearchLimits* limits, int threads, SearchInfo* info) {
+    SearchInfo result;
+    if (info == NULL) info = &result;
+    memset(info, 0, sizeof(SearchInfo));
+
+    Move moves[MAX_MOVES];
+    int n_moves = gen_moves(board, moves);
+    if (n_moves == 0) return false;
+
+    // Any legal move is better than none if the search is stopped before completing an iteration.
+    *move = moves[0];
+
     if (IN_OPENING_BOOK(board)) {
         // If an opening could be found, make that move.
         if (select_opening(board, move)) {
-            sleep(SEARCH_TIMEOUT);
             return true;
         }
     }
 
-    hashmap_clear(hashmap);
+    hashmap_new_search(hashmap);
 
     bool stop = false;
-    start_timer(&stop);
+    parallel_search(board, hashmap, &stop, limits, threads, move, info);
+
+#if SEARCH_STATS
+    print_stats(stderr, &info->stats);
+#endif
+
+    return true;
+}
+
+// Creates a search session with "threads" threads, which wait for searches until "engine_free" is called.
+void engine_init(Engine* engine, HashMap* hashmap, int threads) {
+    memset(engine, 0, sizeof(Engine));
+    engine->hashmap = hashmap;
+    engine->threads = MAX(threads, 1);
+    engine->workers = (Worker*) malloc(engine->threads * sizeof(Worker));
+    mtx_init(&engine->mutex, mtx_plain);
+    cnd_init(&engine->start);
+    cnd_init(&engine->done);
+
+    for (int i = 0; i < engine->threads; i++) {
+        engine->workers[i].engine = engine;
+        engine->workers[i].id = i;
+        thrd_create(&engine->workers[i].thread, engine_worker, &engine->workers[i]);
+    }
+}
+
+void engine_free(Engine* engine) {
+    search_stop(engine);
+    mtx_lock(&engine->mutex);
+    engine->quit = true;
+    cnd_broadcast(&engine->start);
+    mtx_unlock(&engine->mutex);
+
+    for (int i = 0; i < engine->threads; i++) {
+        thrd_join(engine->workers[i].thread, NULL);
+    }
+
+    cnd_destroy(&engine->done);
+    cnd_destroy(&engine->start);
+    mtx_destroy(&engine->mutex);
+    free(engine->workers);
+}
+
+// Starts searching "board" in the background and returns immediately. A search still running is
+// stopped first. The result is available once "search_ready" returns true, or from "search_wait".
+void search_start(Engine* engine, Board* board, SearchLimits* limits) {
+    search_stop(engine);
+    search_wait(engine, NULL);
+
+    SearchResult* result = &engine->result;
+    memset(result, 0, sizeof(SearchResult));
+
+    Move moves[MAX_MOVES];
+    int n_moves = gen_moves(board, moves);
+    result->found = n_moves > 0;
+    if (n_moves == 0) return;
+
+    // Any legal move is better than none if the search is stopped before completing an iteration.
+    result->move = moves[0];
+    if (IN_OPENING_BOOK(board) && select_opening(board, &result->move)) return;
+
+    hashmap_new_search(engine->hashmap);
+
+    mtx_lock(&engine->mutex);
+    engine->board = *board;
+    engine->limits = *limits;
+    engine->stop = false;
+    // Workers are prepared here rather than by their own threads once they wake up, so that a helper
+    // cannot still be clearing its node count while the main thread sums it after the first iteration.
+    for (int i = 0; i < engine->threads; i++) {
+        worker_init(&engine->workers[i], &engine->board, &engine->stop, engine->hashmap, &engine->limits);
+    }
+    engine->running = engine->threads;
+    engine->generation++;
+    cnd_broadcast(&engine->start);
+    mtx_unlock(&engine->mutex);
+}
+
+// Asks the running search to stop without waiting for it, its result is the best move found so far.
+void search_stop(Engine* engine) {
+    STOP(&engine->stop);
+}
+
+// Whether the result of the last search is available, without blocking.
+bool search_ready(Engine* engine) {
+    mtx_lock(&engine->mutex);
+    bool ready = engine->running == 0;
+    mtx_unlock(&engine->mutex);
+    return ready;
+}
+
+// Waits for the last search to finish and copies its result to "result", which may be NULL.
+void search_wait(Engine* engine, SearchResult* result) {
+    mtx_lock(&engine->mutex);
+    while (engine->running > 0) {
+        cnd_wait(&engine->done, &engine->mutex);
+    }
+    if (result != NULL) *result = engine->result;
+    mtx_unlock(&engine->mutex);
+}
+
+// Thread of an engine, which runs one search every time the generation of the engine changes. The
+// worker has already been prepared for the search by "search_start".
+int engine_worker(void* arg) {
+    Worker* worker = (Worker*) arg;
+    Engine* engine = worker->engine;
+    int generation = 0;
+
+    while (true) {
+        mtx_lock(&engine->mutex);
+        while (engine->generation == generation && !engine->quit) {
+            cnd_wait(&engine->start, &engine->mutex);
+        }
+        generation = engine->generation;
+        bool quit = engine->quit;
+        mtx_unlock(&engine->mutex);
+        if (quit) return 0;
+
+        if (worker->id > 0) {
+            search_worker(worker);
+            mtx_lock(&engine->mutex);
+            engine->running--;
+            cnd_broadcast(&engine->done);
+            mtx_unlock(&engine->mutex);
+            continue;
+        }
+
+        TimeManager time;
+        time_manager_init(&time, &engine->limits);
+        Search* search = &worker->search;
+        search->time = &time;
+        search->limits = &engine->limits;
+        search->workers = engine->workers;
+        search->threads = engine->threads;
+        Move selected = engine->result.move;
+        iterative_deepening(search, &worker->board, worker->max_depth, &selected);
+        STOP(&engine->stop);
+
+        // The result is complete once the helpers have stopped as well.
+        mtx_lock(&engine->mutex);
+        while (engine->running > 1) {
+            cnd_wait(&engine->done, &engine->mutex);
+        }
+        engine->result.move = selected;
+        search_info(engine->workers, engine->threads, &engine->result.info);
+        engine->running = 0;
+        cnd_broadcast(&engine->done);
+        mtx_unlock(&engine->mutex);
+    }
+}
+
+// Starts searching the position after the opponent's expected reply on the opponent's time. "board"
+// is the position after the engine's move. Returns false if there is nothing to ponder.
+bool ponder_start(Ponder* ponder, Engine* engine, Board* board, Move* reply, SearchLimits* limits) {
+    Move moves[MAX_MOVES];
+    int n_moves = gen_moves(board, moves);
+    bool legal = false;
+    for (int i = 0; i < n_moves && !IS_NULL_MOVE(*reply); i++) {
+        legal |= SAME_MOVE(moves[i], *reply);
+    }
+    if (!legal) return false;
+
+    Board after = *board;
+    make_move(&after, reply);
+    // Nothing to search if the reply ends the game.
+    if (gen_moves(&after, moves) == 0) return false;
+
+    ponder->engine = engine;
+    ponder->reply = *reply;
+    ponder->pondering = true;
+    SearchLimits ponder_limits = *limits;
+    ponder_limits.ponder = &ponder->pondering;
+    search_start(engine, &after, &ponder_limits);
+    return true;
+}
+
+// Called once the opponent has played "played". On a ponder hit, the search continues with the limits
+// given to "ponder_start" as if it had started now, and its result is collected as for any other search.
+// On a miss, the search is stopped and false is returned, after which the actual position is searched.
+bool ponder_hit(Ponder* ponder, Move* played) {
+    bool hit = SAME_MOVE(*played, ponder->reply);
+    if (!hit) search_stop(ponder->engine);
+    __atomic_store_n(&ponder->pondering, false, __ATOMIC_RELEASE);
+    return hit;
+}
+
+// Lazy SMP: every thread runs its own iterative deepening loop on the same position, and the threads
+// only cooperate through the shared transposition table. The main thread runs on the calling thread,
+// enforces the limits and its result is returned. Once it finishes, the helpers are stopped as well.
+int parallel_search(Board* board, HashMap* hashmap, bool* stop, SearchLimits* limits, int threads, Move* selected, SearchInfo* info) {
+    TimeManager time;
+    time_manager_init(&time, limits);
+
+    threads = MAX(threads, 1);
+    Worker* workers = (Worker*) malloc(threads * sizeof(Worker));
+
+    for (int i = 1; i < threads; i++) {
+        workers[i].id = i;
+        worker_init(&workers[i], board, stop, hashmap, limits);
+        thrd_create(&workers[i].thread, search_worker, &workers[i]);
+    }
+
+    workers[0].id = 0;
+    worker_init(&workers[0], board, stop, hashmap, limits);
+    Search* search = &workers[0].search;
+    search->time = &time;
+    search->limits = limits;
+    search->workers = workers;
+    search->threads = threads;
+    int score = iterative_deepening(search, board, workers[0].max_depth, selected);
+
+    STOP(stop);
+    for (int i = 1; i < threads; i++) {
+        thrd_join(workers[i].thread, NULL);
+    }
+
+    if (info != NULL) search_info(workers, threads, info);
+
+    free(workers);
+    return score;
+}
+
+// Prepares a worker, whose id is already set, to search "board" within the depth limit of "limits".
+void worker_init(Worker* worker, Board* board, bool* stop, HashMap* hashmap, SearchLimits* limits) {
+    worker->board = *board;
+    worker->max_depth = limits->depth > 0 ? MIN(limits->depth, MAX_PLY - 1) : MAX_PLY - 1;
+    search_init(&worker->search, stop, hashmap);
+    worker->search.id = worker->id;
+    worker->search.driver = limits->driver;
+}
 
-    Move selected;
+// Sums the statistics of every thread of a finished search. The depth and principal variation are
+// those of the main thread.
+void search_info(Worker* workers, int threads, SearchInfo* info) {
+    Search* search = &workers[0].search;
+    memset(info, 0, sizeof(SearchInfo));
+    info->depth = search->depth;
+    info->pv_length = search->previous_pv_length;
+    memcpy(info->pv, search->previous_pv, info->pv_length * sizeof(Move));
+    for (int i = 0; i < threads; i++) {
+        Search* worker = &workers[i].search;
+        info->nodes += worker->nodes;
+        info->qnodes += worker->qnodes;
+        info->pruned.reverse_futility += worker->pruned.reverse_futility;
+        info->pruned.futility += worker->pruned.futility;
+        info->pruned.razoring += worker->pruned.razoring;
+        info->pruned.late_move += worker->pruned.late_move;
+#if SEARCH_STATS
+        worker->stats.nodes = worker->nodes;
+        worker->stats.qnodes = worker->qnodes;
+        add_stats(&info->stats, &worker->stats);
+#endif
+    }
+}
 
+int search_worker(void* arg) {
+    Worker* worker = (Worker*) arg;
+    worker->selected = (Move) {0, 0, 0};
+    iterative_deepening(&worker->search, &worker->board, worker->max_depth, &worker->selected);
+    return 0;
+}
+
+int iterative_deepening(Search* search, Board* board, int max_depth, Move* selected) {
+#if SEARCH_STATS
+    uint64_t lookups = magic_lookups;
+#endif
     int score = 0;
-    int depth = 1;
-    while (!stop) {
-        // MTDF
-        int upper = INT_MAX;
-        int lower = INT_MIN;
-
-        while (lower < upper && !stop) {
-            int beta = MAX(score, lower + 1);
-            score = search_moves(board, &stop, hashmap, depth, beta - 1, beta, &selected);
-            if (score < beta) {
-                upper = score;
-            } else {
-                lower = score;
-            }
+    // Every other helper starts one ply deeper, so the threads are spread over two depths at once
+    // rather than all searching the same tree in lockstep.
+    for (int depth = 1 + search->id % 2; depth <= max_depth && !STOPPED(search); depth++) {
+        search->seldepth = 0;
+        int eval = search->driver == DRIVER_PVS ? aspiration(search, board, depth, score, selected) : mtdf(search, board, depth, score, selected);
+        if (STOPPED(search)) break;
+        score = eval;
+        search->depth = depth;
+
+        // Null window searches do not leave a principal variation behind, in which case it is only the best move.
+        if (search->pv_length[0] == 0) {
+            search->pv[0][0] = *selected;
+            search->pv_length[0] = 1;
+        }
+        memcpy(search->previous_pv, search->pv[0], search->pv_length[0] * sizeof(Move));
+        search->previous_pv_length = search->pv_length[0];
+
+        if (search->limits != NULL && search->limits->on_iteration != NULL) {
+            report_iteration(search, depth, score);
         }
-        depth++;
+
+        if (search->time != NULL && !time_next_iteration(search->time, selected)) break;
     }
+#if SEARCH_STATS
+    search->stats.magic_lookups += magic_lookups - lookups;
+#endif
+    return score;
+}
 
-    *move = selected;
+// Passes the statistics of the iteration that just completed to the callback of the search limits.
+void report_iteration(Search* search, int depth, int score) {
+    IterationInfo info;
+    info.depth = depth;
+    info.seldepth = search->seldepth;
+    info.score = score;
+    info.nodes = search_nodes(search);
+    info.time = time_elapsed(search->time);
+    info.nps = info.nodes * 1000 / MAX(info.time, 1);
+    info.hashfull = hashmap_hashfull(search->hashmap);
+    info.pv_length = search->pv_length[0];
+    memcpy(info.pv, search->pv[0], info.pv_length * sizeof(Move));
 
-    Move moves[MAX_MOVES];
-	return gen_moves(board, moves) > 0;
+    search->limits->on_iteration(&info, search->limits->data);
+}
+
+#if SEARCH_STATS
+void add_stats(SearchStats* total, SearchStats* stats) {
+    total->nodes += stats->nodes;
+    total->qnodes += stats->qnodes;
+    total->tt_probes += stats->tt_probes;
+    total->tt_hits += stats->tt_hits;
+    total->tt_cutoffs += stats->tt_cutoffs;
+    total->null_move_tries += stats->null_move_tries;
+    total->null_move_cutoffs += stats->null_move_cutoffs;
+    for (int i = 0; i < STATS_CUTOFF_MOVES; i++) {
+        total->beta_cutoffs[i] += stats->beta_cutoffs[i];
+    }
+    total->researches += stats->researches;
+    total->gen_time += stats->gen_time;
+    total->order_time += stats->order_time;
+    total->eval_time += stats->eval_time;
+    total->magic_lookups += stats->magic_lookups;
+}
+
+// Writes the statistics as a single line of JSON. Times are in microseconds.
+void print_stats(FILE* file, SearchStats* stats) {
+    fprintf(file, "{\"nodes\": %llu, \"qnodes\": %llu, ", stats->nodes, stats->qnodes);
+    fprintf(file, "\"tt_probes\": %llu, \"tt_hits\": %llu, \"tt_cutoffs\": %llu, ", stats->tt_probes, stats->tt_hits, stats->tt_cutoffs);
+    fprintf(file, "\"null_move_tries\": %llu, \"null_move_cutoffs\": %llu, ", stats->null_move_tries, stats->null_move_cutoffs);
+    fprintf(file, "\"beta_cutoffs\": [");
+    for (int i = 0; i < STATS_CUTOFF_MOVES; i++) {
+        fprintf(file, i > 0 ? ", %llu" : "%llu", stats->beta_cutoffs[i]);
+    }
+    fprintf(file, "], \"researches\": %llu, ", stats->researches);
+    fprintf(file, "\"gen_time\": %llu, \"order_time\": %llu, \"eval_time\": %llu, ", stats->gen_time / 1000, stats->order_time / 1000, stats->eval_time / 1000);
+    fprintf(file, "\"magic_lookups\": %llu}\n", stats->magic_lookups);
+}
+#endif
+
+void search_init(Search* search, bool* stop, HashMap* hashmap) {
+    memset(search, 0, sizeof(Search));
+    search->stop = stop;
+    search->hashmap = hashmap;
+}
+
+// Counts a searched node. Every POLL_NODES nodes the main thread checks whether the search has run out
+// of time or nodes and stops all threads if so.
+void count_node(Search* search) {
+    // Stored atomically, as the main thread reads the node counts of all threads while searching.
+    __atomic_store_n(&search->nodes, search->nodes + 1, __ATOMIC_RELAXED);
+    if (search->time != NULL && (search->nodes & (POLL_NODES - 1)) == 0 && time_up(search->time, search_nodes(search))) {
+        STOP(search->stop);
+    }
+}
+
+// Nodes searched so far by all threads of the search, read by the main thread while the others search.
+uint64_t search_nodes(Search* search) {
+    if (search->workers == NULL) return search->nodes;
+    uint64_t nodes = 0;
+    for (int i = 0; i < search->threads; i++) {
+        nodes += __atomic_load_n(&search->workers[i].search.nodes, __ATOMIC_RELAXED);
+    }
+    return nodes;
+}
+
+int mtdf(Search* search, Board* board, int depth, int guess, Move* selected) {
+    int upper = INT_MAX;
+    int lower = INT_MIN;
+
+    int score = guess;
+    while (lower < upper && !STOPPED(search)) {
+        int beta = MAX(score, lower + 1);
+        score = search_moves(search, board, depth, beta - 1, beta, selected);
+        if (score < beta) {
+            upper = score;
+        } else {
+            lower = score;
+        }
+    }
+
+    return score;
+}
+
+// Searches iterations with a window around the score of the previous iteration, which cuts off far more
+// of the tree than a full window. When the score falls outside of the window, that side of the window
+// is widened and the iteration is searched again.
+int aspiration(Search* search, Board* board, int depth, int guess, Move* selected) {
+    if (depth < ASPIRATION_DEPTH) {
+        return search_moves(search, board, depth, -INF, INF, selected);
+    }
+
+    int delta = ASPIRATION_WINDOW;
+    int alpha = MAX(guess - delta, -INF);
+    int beta = MIN(guess + delta, INF);
+
+    while (true) {
+        int score = search_moves(search, board, depth, alpha, beta, selected);
+        if (STOPPED(search)) return score;
+
+        delta *= 2;
+        if (score <= alpha) {
+            STATS_ADD(&search->stats, researches, 1);
+            alpha = MAX(score - delta, -INF);
+        } else if (score >= beta) {
+            STATS_ADD(&search->stats, researches, 1);
+            beta = MIN(score + delta, INF);
+        } else {
+            return score;
+        }
+    }
+}
+
+// Principal Variation Search of a child node, returning its score from the parent's point of view.
+// Only the first move gets the full window. The others are searched with a null window that can only
+// prove them worse than the best move so far, and are searched again with the full window if they
+// turn out to be better.
+int pv_search(Search* search, Board* board, int depth, int ply, int alpha, int beta, bool first) {
+    if (first || beta - alpha == 1) {
+        return -alpha_beta(search, board, depth, ply, -beta, -alpha);
+    }
+
+    int eval = -alpha_beta(search, board, depth, ply, -alpha - 1, -alpha);
+    if (eval > alpha && eval < beta) {
+        STATS_ADD(&search->stats, researches, 1);
+        eval = -alpha_beta(search, board, depth, ply, -beta, -alpha);
+    }
+    return eval;
 }
 
-int search_moves(Board* board, bool* stop, HashMap* hashmap, int depth, int alpha, int beta, Move* selected) {
+int search_moves(Search* search, Board* board, int depth, int alpha, int beta, Move* selected) {
     Move moves[MAX_MOVES];
+    STATS_START(start);
     int n_moves = gen_moves(board, moves);
+    STATS_TIME(&search->stats, gen_time, start);
 
+    STATS_START(order_start);
     order_moves(board, moves, n_moves);
+    STATS_TIME(&search->stats, order_time, order_start);
 
+    // Search the best move from the previous iteration first.
+    int score;
+    Move hash_move = {0, 0, 0};
+    hashmap_get(search->hashmap, board->key, depth, &score, &hash_move);
+    hash_move.flags = infer_flags(board, hash_move.from, hash_move.to, PROMOTED_PIECE(hash_move.flags));
+    if (search->previous_pv_length > 0) {
+        hash_move = search->previous_pv[0];
+    }
+    for (int i = 1; i < n_moves && !IS_NULL_MOVE(hash_move); i++) {
+        if (SAME_MOVE(moves[i], hash_move)) {
+            memmove(&moves[1], &moves[0], i * sizeof(Move));
+            moves[0] = hash_move;
+            break;
+        }
+    }
+
+    int original_alpha = alpha;
     Move best = {0, 0, 0};
+    search->pv_length[0] = 0;
 
-    const Board copy = *board;
-    for (int i = 0; i < n_moves && !*stop; i++) {
+    for (int i = 0; i < n_moves && !STOPPED(search); i++) {
         Move* move = &moves[i];
-        make_move(board, move);
-        int eval = -alpha_beta(board, stop, hashmap, depth - 1, 1, -beta, -alpha);
-        *board = copy; // Undo move.
+        search->stack[0] = *move;
+        Undo undo = make_move(board, move);
+        int eval = pv_search(search, board, depth - 1, 1, alpha, beta, i == 0);
+        unmake_move(board, move, &undo);
 
         if (eval > alpha) {
             alpha = eval;
             best = *move;
+            if (alpha >= beta) break;
+            update_pv(search, 0, move);
         }
     }
 
+    if (STOPPED(search)) return alpha;
+
     if (best.to != best.from) {
         *selected = best;
     }
 
+    int flag = alpha >= beta ? BOUND_LOWER : alpha > original_alpha ? BOUND_EXACT : BOUND_UPPER;
+    hashmap_set(search->hashmap, board->key, alpha, depth, flag, &best);
+
     return alpha;
 }
 
-int alpha_beta(Board* board, bool* stop, HashMap* hashmap, int depth, int ply, int alpha, int beta) {
-    if (*stop) return 0;
-    if (!is_legal(board)) return INF;
+int alpha_beta(Search* search, Board* board, int depth, int ply, int alpha, int beta) {
+    if (STOPPED(search)) return 0;
+
+    search->pv_length[ply] = ply;
+
+    // Once depth of 0 is reached, search all remaining captures to reach a stable board state.
+    if (depth <= 0) return quiescence(search, board, ply, alpha, beta);
+
+    count_node(search);
+    search->seldepth = MAX(search->seldepth, ply);
 
     if (ply > 0) {
         alpha = MAX(alpha, -CHECKMATE + ply);
@@ -102,96 +559,371 @@ int alpha_beta(Board* board, bool* stop, HashMap* hashmap, int depth, int ply, i
         if (alpha >= beta) return alpha;
     }
 
-    uint64_t board_hash = hash(board);
+    if (ply >= MAX_PLY) return evaluate(board);
+
+    HashMap* hashmap = search->hashmap;
+    uint64_t board_hash = board->key;
     int score, flag;
-    if (flag = hashmap_get(hashmap, board_hash, depth, &score)) {
+    Move hash_move = {0, 0, 0};
+    flag = hashmap_get(hashmap, board_hash, depth, &score, &hash_move);
+    STATS_ADD(&search->stats, tt_probes, 1);
+    STATS_ADD(&search->stats, tt_hits, flag != 0 || !IS_NULL_MOVE(hash_move));
+    if (flag) {
+        score = score_from_hashmap(score, ply);
         if (flag == BOUND_EXACT || (flag == BOUND_UPPER && score <= alpha) || (flag == BOUND_LOWER && score >= beta)) {
+            STATS_ADD(&search->stats, tt_cutoffs, 1);
             return score;
         }
     }
-
-    if (depth <= 0) {
-        // Once depth of 0 is reached, search all remaining captures to reach a stable board state.
-        int eval = quiescence(board, alpha, beta);
-        hashmap_set(hashmap, board_hash, eval, depth, BOUND_EXACT);
-        return eval;
+    if (!IS_NULL_MOVE(hash_move)) {
+        hash_move.flags = infer_flags(board, hash_move.from, hash_move.to, PROMOTED_PIECE(hash_move.flags));
+    }
+    // The principal variation of the previous iteration is searched first, even if the table lost it.
+    if (on_previous_pv(search, ply)) {
+        hash_move = search->previous_pv[ply];
     }
 
-    // Null Move Pruning.
-    switch_ply(board);
-    uint8_t en_passant = board->en_passant;
-    board->en_passant = 0;
-    int eval = -alpha_beta(board, stop, hashmap, depth - 2, ply + 2, -beta, -beta + 1);
-    board->en_passant = en_passant;
-    switch_ply(board);
+    // Forward pruning only happens in null window nodes, where a wrong decision cannot change the
+    // principal variation directly.
+    bool pv_node = beta - alpha > 1;
+    bool in_check = is_in_check(board);
+    int static_eval = in_check ? -INF : static_evaluation(search, board);
 
-    if (eval >= beta) {
-        hashmap_set(hashmap, board_hash, beta, depth, BOUND_LOWER);
-        return beta;
+    // Reverse Futility Pruning: a position that stays above beta even after giving up a margin per
+    // remaining ply is unlikely to fall below it in a shallow search.
+    if (REVERSE_FUTILITY_PRUNING && !pv_node && !in_check && depth <= RFP_DEPTH && ABS(beta) < MATE_BOUND) {
+        if (static_eval - RFP_MARGIN * depth >= beta) {
+            search->pruned.reverse_futility++;
+            return beta;
+        }
     }
 
-    Move moves[MAX_MOVES];
-    int n_moves = gen_moves(board, moves);
-    if (n_moves == 0) {
-        if (is_in_check(board)) {
-            return -CHECKMATE + ply;
+    // Razoring: a position far below alpha near the horizon is only searched for captures that could
+    // bring it back up.
+    if (RAZORING && !pv_node && !in_check && depth <= RAZOR_DEPTH && static_eval + RAZOR_MARGIN * depth <= alpha) {
+        int eval = quiescence(search, board, ply, alpha, beta);
+        if (eval <= alpha) {
+            search->pruned.razoring++;
+            return alpha;
         }
-        return 0;
     }
 
-    order_moves(board, moves, n_moves);
-    const Board copy = *board;
+    // Null Move Pruning: if passing the turn still fails high, a real move almost certainly will too.
+    // Passing is not possible in check, and not safe with only pawns left, where being forced to move
+    // is often a disadvantage. Two null moves in a row would only search the same position again.
+    Move* previous = &search->stack[ply - 1];
+    if (!pv_node && !in_check && depth >= NULL_MOVE_DEPTH && ply >= search->verify_ply && !IS_NULL_MOVE(*previous)
+        && static_eval >= beta && ABS(beta) < MATE_BOUND && has_non_pawn_material(board)) {
+        // Reduce more at higher depths, and the further the static evaluation is above beta.
+        int reduction = NULL_MOVE_REDUCTION + depth / 4 + MIN((static_eval - beta) / NULL_MOVE_MARGIN, 3);
 
-    for (int i = 0; i < n_moves && !*stop; i++) {
-        Move* move = &moves[i];
-        make_move(board, move);
-        int eval = -alpha_beta(board, stop, hashmap, depth - 1, ply + 1, -beta, -alpha);
-        *board = copy; // Undo move.
+        STATS_ADD(&search->stats, null_move_tries, 1);
+        Move none = {0, 0, 0};
+        search->stack[ply] = none;
+        switch_ply(board);
+        uint8_t en_passant = board->en_passant;
+        set_en_passant(board, 0);
+        int eval = -alpha_beta(search, board, depth - 1 - reduction, ply + 1, -beta, -beta + 1);
+        set_en_passant(board, en_passant);
+        switch_ply(board);
+
+        if (eval >= beta && !STOPPED(search)) {
+            // At high depths, confirm the cutoff with a reduced search without null moves near this node,
+            // which catches zugzwang positions the null move would misjudge.
+            if (depth >= NULL_VERIFY_DEPTH && search->verify_ply == 0) {
+                search->verify_ply = ply + 3 * (depth - 1 - reduction) / 4;
+                eval = alpha_beta(search, board, depth - 1 - reduction, ply, beta - 1, beta);
+                search->verify_ply = 0;
+            }
+            if (eval >= beta) {
+                STATS_ADD(&search->stats, null_move_cutoffs, 1);
+                hashmap_set(hashmap, board_hash, score_to_hashmap(beta, ply), depth, BOUND_LOWER, NULL);
+                return beta;
+            }
+        }
+    }
+
+    Move* countermove = IS_NULL_MOVE(*previous) ? NULL : &search->countermoves[previous->from][previous->to];
+
+    MovePicker picker;
+    STATS_START(info_start);
+    init_move_picker(&picker, board, &hash_move, search->killers[ply], countermove, search->history[SIDE(board->active_color)]);
+    STATS_TIME(&search->stats, gen_time, info_start);
+#if SEARCH_STATS
+    picker.stats = &search->stats;
+#endif
+
+    // Futility Pruning: near the horizon, quiet moves cannot raise a static evaluation this far below
+    // alpha by enough to matter.
+    bool futile = FUTILITY_PRUNING && !pv_node && !in_check && depth <= FUTILITY_DEPTH && ABS(alpha) < MATE_BOUND && static_eval + FUTILITY_MARGIN * depth <= alpha;
+    // Late Move Pruning: once enough moves have been searched at a shallow depth, the remaining quiet
+    // moves are unlikely to cause a cutoff and are skipped.
+    int late_moves = LATE_MOVE_PRUNING && !pv_node && !in_check && depth <= LMP_DEPTH ? LMP_BASE + depth * depth : MAX_MOVES;
+
+    int original_alpha = alpha;
+    Move move;
+    Move best = {0, 0, 0};
+    Move quiets[MAX_MOVES];
+    int n_quiets = 0;
+    int n_moves = 0;
+    while (!STOPPED(search) && next_move(&picker, &move)) {
+        n_moves++;
+        // Winning captures and promotions are never reduced, losing captures are reduced like quiet moves.
+        bool reducible = (!IS_CAPTURE(move.flags) || picker.stage == STAGE_BAD_CAPTURES) && !IS_PROMOTION(move.flags);
+        int history = picker.history[move.from][move.to];
+
+        bool quiet = !IS_CAPTURE(move.flags) && !IS_PROMOTION(move.flags);
+
+        search->stack[ply] = move;
+        Undo undo = make_move(board, &move);
+        bool gives_check = is_in_check(board);
+
+        // Moves are only pruned once a move has been searched, and never when they give check.
+        if (n_moves > 1 && quiet && !gives_check && (futile || n_moves > late_moves)) {
+            unmake_move(board, &move, &undo);
+            if (futile) {
+                search->pruned.futility++;
+            } else {
+                search->pruned.late_move++;
+            }
+            continue;
+        }
+
+        int eval;
+        int reduction = 0;
+        if (LATE_MOVE_REDUCTIONS && depth >= LMR_DEPTH && n_moves > LMR_MOVES && reducible && !in_check && !gives_check) {
+            reduction = late_move_reduction(&picker, &move, depth, n_moves, history);
+        }
+        if (reduction > 0) {
+            // Late moves are expected to fail low, which a reduced null window search can confirm cheaply.
+            // Moves that beat alpha anyway are searched again at full depth.
+            eval = -alpha_beta(search, board, depth - 1 - reduction, ply + 1, -alpha - 1, -alpha);
+            if (eval > alpha) {
+                STATS_ADD(&search->stats, researches, 1);
+                eval = pv_search(search, board, depth - 1, ply + 1, alpha, beta, false);
+            }
+        } else {
+            eval = pv_search(search, board, depth - 1, ply + 1, alpha, beta, n_moves == 1);
+        }
+        unmake_move(board, &move, &undo);
 
         if (eval >= beta) {
-            hashmap_set(hashmap, board_hash, beta, depth, BOUND_LOWER);
+            STATS_ADD(&search->stats, beta_cutoffs[MIN(n_moves, STATS_CUTOFF_MOVES) - 1], 1);
+            if (!IS_CAPTURE(move.flags)) {
+                update_quiet_stats(search, board, depth, ply, &move, quiets, n_quiets);
+            }
+            hashmap_set(hashmap, board_hash, score_to_hashmap(beta, ply), depth, BOUND_LOWER, &move);
             return beta;
         }
         if (eval > alpha) {
             alpha = eval;
+            best = move;
+            update_pv(search, ply, &move);
+        }
+        if (!IS_CAPTURE(move.flags)) {
+            quiets[n_quiets++] = move;
+        }
+    }
+
+    if (STOPPED(search)) return 0;
+
+    if (n_moves == 0) {
+        if (picker.info.checkers != 0) {
+            return -CHECKMATE + ply;
         }
+        return 0;
     }
 
-    hashmap_set(hashmap, board_hash, alpha, depth, BOUND_UPPER);
+    hashmap_set(hashmap, board_hash, score_to_hashmap(alpha, ply), depth, alpha > original_alpha ? BOUND_EXACT : BOUND_UPPER, &best);
 
     return alpha;
 }
 
-int quiescence(Board* board, int alpha, int beta) {
-    int eval = evaluate(board);
+// Whether the side to move has any pieces other than pawns and the king.
+bool has_non_pawn_material(Board* board) {
+    Bitboard pawns_and_kings = board->state[PAWN] | board->state[KING];
+    return (get_pieces_color(board, board->active_color) & ~pawns_and_kings) != 0;
+}
 
-    if (eval >= beta) return beta;
-    if (eval > alpha) alpha = eval;
+// Reduction of a late move from the table, adjusted for how likely the move is to be good. Killers,
+// the countermove, losing captures and moves with a good history are reduced less than the table
+// suggests, moves with a bad history more. A reduced move is always searched at least one ply deep.
+int late_move_reduction(MovePicker* picker, Move* move, int depth, int n_moves, int history) {
+    int reduction = reductions[MIN(depth, MAX_PLY - 1)][MIN(n_moves, MAX_MOVES - 1)];
+    if (IS_CAPTURE(move->flags) || is_refutation(picker, move)) reduction--;
+    if (!IS_CAPTURE(move->flags)) reduction -= history / LMR_HISTORY_DIVISOR;
+    return MAX(0, MIN(reduction, depth - 2));
+}
+
+// Makes "move" followed by the principal variation of its child the principal variation of "ply".
+void update_pv(Search* search, int ply, Move* move) {
+    search->pv[ply][ply] = *move;
+    int length = MAX(search->pv_length[ply + 1], ply + 1);
+    memcpy(&search->pv[ply][ply + 1], &search->pv[ply + 1][ply + 1], (length - ply - 1) * sizeof(Move));
+    search->pv_length[ply] = length;
+}
+
+// Whether the moves leading to this node follow the principal variation of the previous iteration.
+bool on_previous_pv(Search* search, int ply) {
+    if (ply >= search->previous_pv_length) return false;
+    for (int i = 0; i < ply; i++) {
+        if (!SAME_MOVE(search->stack[i], search->previous_pv[i])) return false;
+    }
+    return true;
+}
+
+// Mate scores are stored relative to the position rather than the root, so they remain correct
+// when the position is reached again at a different ply.
+int score_to_hashmap(int score, int ply) {
+    if (score >= MATE_BOUND) return score + ply;
+    if (score <= -MATE_BOUND) return score - ply;
+    return score;
+}
+
+int score_from_hashmap(int score, int ply) {
+    if (score >= MATE_BOUND) return score - ply;
+    if (score <= -MATE_BOUND) return score + ply;
+    return score;
+}
+
+int quiescence(Search* search, Board* board, int ply, int alpha, int beta) {
+    if (STOPPED(search)) return 0;
+    count_node(search);
+    search->qnodes++;
+    search->pv_length[ply] = ply;
+    search->seldepth = MAX(search->seldepth, ply);
+
+    if (ply >= MAX_PLY) return evaluate(board);
+
+    // Entries of any depth are deep enough for quiescence, including those stored by quiescence itself.
+    HashMap* hashmap = search->hashmap;
+    int score, flag;
+    Move hash_move = {0, 0, 0};
+    flag = hashmap_get(hashmap, board->key, 0, &score, &hash_move);
+    STATS_ADD(&search->stats, tt_probes, 1);
+    STATS_ADD(&search->stats, tt_hits, flag != 0 || !IS_NULL_MOVE(hash_move));
+    if (flag) {
+        score = score_from_hashmap(score, ply);
+        if (flag == BOUND_EXACT || (flag == BOUND_UPPER && score <= alpha) || (flag == BOUND_LOWER && score >= beta)) {
+            STATS_ADD(&search->stats, tt_cutoffs, 1);
+            return score;
+        }
+    }
+
+    int stand_pat = static_evaluation(search, board);
+    if (stand_pat >= beta) return beta;
+
+    PositionInfo info;
+    STATS_START(info_start);
+    gen_position_info(board, &info);
+    STATS_TIME(&search->stats, gen_time, info_start);
+    bool in_check = info.checkers != 0;
+
+    // Delta Pruning: if not even capturing a queen brings the score back to alpha, no capture will.
+    if (DELTA_PRUNING && !in_check && stand_pat + QUEEN_VALUE + DELTA_MARGIN <= alpha) return alpha;
+
+    int original_alpha = alpha;
+    if (stand_pat > alpha) alpha = stand_pat;
 
     Move moves[MAX_MOVES];
-    int n_moves = gen_captures(board, moves);
-    order_moves(board, moves, n_moves);
+    STATS_START(start);
+    int n_moves = gen_capture_moves(board, &info, moves, 0);
+    STATS_TIME(&search->stats, gen_time, start);
 
-    const Board copy = *board;
+    // A capture that loses material cannot raise the score above the stand pat evaluation, and neither
+    // can one that wins less than the distance to alpha. Both are only kept when in check, where they
+    // may be the only way out.
+    if (!in_check) {
+        int n_good = 0;
+        for (int i = 0; i < n_moves; i++) {
+            Move* move = &moves[i];
+            Piece victim = IS_EN_PASSANT(move->flags) ? PAWN : board->positions[move->to];
+            int gain = PIECE_VALUES[victim] + PIECE_VALUES[PROMOTED_PIECE(move->flags)];
+            if (DELTA_PRUNING && stand_pat + gain + DELTA_MARGIN <= alpha) continue;
+            if (is_losing_capture(board, move)) continue;
+            moves[n_good++] = *move;
+        }
+        n_moves = n_good;
+    }
+    STATS_START(order_start);
+    order_captures(board, moves, n_moves);
+    STATS_TIME(&search->stats, order_time, order_start);
+
+    // Search the move stored in the transposition table first.
+    for (int i = 1; i < n_moves && !IS_NULL_MOVE(hash_move); i++) {
+        if (moves[i].from == hash_move.from && moves[i].to == hash_move.to && PROMOTED_PIECE(moves[i].flags) == PROMOTED_PIECE(hash_move.flags)) {
+            Move move = moves[i];
+            memmove(&moves[1], &moves[0], i * sizeof(Move));
+            moves[0] = move;
+            break;
+        }
+    }
 
+    Move best = {0, 0, 0};
     for (int i = 0; i < n_moves; i++) {
-        make_move(board, &moves[i]);
-        eval = -quiescence(board, -beta, -alpha);
-        *board = copy; // Undo move.
+        Undo undo = make_move(board, &moves[i]);
+        int eval = -quiescence(search, board, ply + 1, -beta, -alpha);
+        unmake_move(board, &moves[i], &undo);
 
-        if (eval >= beta) return beta;
-        if (eval > alpha) alpha = eval;
+        if (STOPPED(search)) return 0;
+        if (eval >= beta) {
+            STATS_ADD(&search->stats, beta_cutoffs[MIN(i + 1, STATS_CUTOFF_MOVES) - 1], 1);
+            hashmap_set(hashmap, board->key, score_to_hashmap(beta, ply), 0, BOUND_LOWER, &moves[i]);
+            return beta;
+        }
+        if (eval > alpha) {
+            alpha = eval;
+            best = moves[i];
+        }
     }
 
+    hashmap_set(hashmap, board->key, score_to_hashmap(alpha, ply), 0, alpha > original_alpha ? BOUND_EXACT : BOUND_UPPER, &best);
+
     return alpha;
 }
 
+// Static evaluation of the position, cached per thread as quiescence and the pruning decisions of
+// alpha_beta evaluate many positions more than once.
+int static_evaluation(Search* search, Board* board) {
+    EvalEntry* entry = &search->eval_cache[board->key & (EVAL_CACHE_SIZE - 1)];
+    if (entry->key != board->key) {
+        STATS_START(start);
+        entry->key = board->key;
+        entry->eval = evaluate(board);
+        STATS_TIME(&search->stats, eval_time, start);
+    }
+    return entry->eval;
+}
+
+// Orders captures by most valuable victim, least valuable attacker.
+void order_captures(Board* board, Move* moves, int size) {
+    int scores[MAX_MOVES];
+    for (int i = 0; i < size; i++) {
+        scores[i] = score_capture(board, &moves[i]);
+    }
+
+    for (int i = 1; i < size; i++) {
+        int score = scores[i];
+        Move move = moves[i];
+        int j = i;
+        while (j > 0 && scores[j - 1] < score) {
+            scores[j] = scores[j - 1];
+            moves[j] = moves[j - 1];
+            j--;
+        }
+        scores[j] = score;
+        moves[j] = move;
+    }
+}
+
 void order_moves(Board* board, Move* moves, int size) {
     int scores[MAX_MOVES];
     Move best;
 
+    PositionInfo info;
+    gen_position_info(board, &info);
     for (int i = 0; i < size; i++) {
-        scores[i] = -score_move(board, &moves[i]);
+        scores[i] = -score_move(board, &moves[i], &info);
     }
 
     // Sort moves based on their scores.
@@ -209,4 +941,206 @@ void order_moves(Board* board, Move* moves, int size) {
             j--;
         }
     }
+}
+
+// Rewards a quiet move that caused a beta cutoff, and penalises the quiet moves searched before it
+// that failed to.
+void update_quiet_stats(Search* search, Board* board, int depth, int ply, Move* move, Move* quiets, int n_quiets) {
+    Move* killers = search->killers[ply];
+    if (!SAME_MOVE(*move, killers[0])) {
+        killers[1] = killers[0];
+        killers[0] = *move;
+    }
+
+    Move* previous = &search->stack[ply - 1];
+    if (!IS_NULL_MOVE(*previous)) {
+        search->countermoves[previous->from][previous->to] = *move;
+    }
+
+    int (*history)[64] = search->history[SIDE(board->active_color)];
+    int bonus = MIN(depth * depth, HISTORY_BONUS_MAX);
+    update_history(&history[move->from][move->to], bonus);
+    for (int i = 0; i < n_quiets; i++) {
+        update_history(&history[quiets[i].from][quiets[i].to], -bonus);
+    }
+}
+
+// Moves the score towards the bonus, by less the closer it already is to the limit.
+void update_history(int* history, int bonus) {
+    *history += bonus - *history * ABS(bonus) / HISTORY_MAX;
+}
+
+void init_move_picker(MovePicker* picker, Board* board, Move* hash_move, Move* killers, Move* countermove, int (*history)[64]) {
+    picker->board = board;
+    gen_position_info(board, &picker->info);
+
+    Move none = {0, 0, 0};
+    picker->hash_move = hash_move != NULL ? *hash_move : none;
+    picker->killers[0] = killers != NULL ? killers[0] : none;
+    picker->killers[1] = killers != NULL ? killers[1] : none;
+    picker->countermove = countermove != NULL ? *countermove : none;
+    picker->history = history;
+
+    picker->stage = STAGE_HASH_MOVE;
+    picker->index = 0;
+    picker->end = 0;
+    picker->n_captures = 0;
+    picker->bad_captures = 0;
+    picker->n_moves = 0;
+}
+
+bool next_move(MovePicker* picker, Move* move) {
+    Board* board = picker->board;
+
+    switch (picker->stage) {
+        case STAGE_HASH_MOVE:
+            picker->stage++;
+#if !STAGED_MOVE_GENERATION
+            gen_picker_captures(picker);
+            gen_picker_quiets(picker);
+#endif
+            if (!IS_NULL_MOVE(picker->hash_move) && is_legal_move(board, &picker->info, &picker->hash_move)) {
+                *move = picker->hash_move;
+                return true;
+            }
+            // fall through
+        case STAGE_GEN_CAPTURES:
+            picker->stage++;
+#if STAGED_MOVE_GENERATION
+            gen_picker_captures(picker);
+#endif
+            picker->index = 0;
+            picker->end = picker->bad_captures;
+            // fall through
+        case STAGE_GOOD_CAPTURES:
+            while (picker->index < picker->end) {
+                *move = pick_move(picker);
+                if (!SAME_MOVE(*move, picker->hash_move)) return true;
+            }
+            picker->stage++;
+            picker->index = 0;
+            // fall through
+        case STAGE_KILLERS:
+            // Both killers, followed by the countermove.
+            while (picker->index < 3) {
+                int index = picker->index++;
+                Move* killer = index < 2 ? &picker->killers[index] : &picker->countermove;
+                if (IS_NULL_MOVE(*killer) || SAME_MOVE(*killer, picker->hash_move)) continue;
+                if (index == 2 && (SAME_MOVE(*killer, picker->killers[0]) || SAME_MOVE(*killer, picker->killers[1]))) continue;
+                if (!IS_CAPTURE(killer->flags) && is_legal_move(board, &picker->info, killer)) {
+                    *move = *killer;
+                    return true;
+                }
+            }
+            picker->stage++;
+            // fall through
+        case STAGE_GEN_QUIETS:
+            picker->stage++;
+#if STAGED_MOVE_GENERATION
+            gen_picker_quiets(picker);
+#endif
+            picker->index = picker->n_captures;
+            picker->end = picker->n_moves;
+            // fall through
+        case STAGE_QUIETS:
+            while (picker->index < picker->end) {
+                *move = pick_move(picker);
+                if (!SAME_MOVE(*move, picker->hash_move) && !is_refutation(picker, move)) return true;
+            }
+            picker->stage++;
+            picker->index = picker->bad_captures;
+            picker->end = picker->n_captures;
+            // fall through
+        case STAGE_BAD_CAPTURES:
+            while (picker->index < picker->end) {
+                *move = pick_move(picker);
+                if (!SAME_MOVE(*move, picker->hash_move)) return true;
+            }
+            picker->stage++;
+    }
+
+    return false;
+}
+
+// Generates the captures and scores them, with losing captures moved to the end to be tried last.
+void gen_picker_captures(MovePicker* picker) {
+    Board* board = picker->board;
+    STATS_START(start);
+    int n_captures = gen_capture_moves(board, &picker->info, picker->moves, 0);
+    STATS_TIME(picker->stats, gen_time, start);
+    STATS_START(order_start);
+
+    int end = n_captures;
+    for (int i = 0; i < end; i++) {
+        Move* capture = &picker->moves[i];
+        if (is_losing_capture(board, capture)) {
+            end--;
+            Move temp = *capture;
+            *capture = picker->moves[end];
+            picker->moves[end] = temp;
+            i--;
+        }
+    }
+    for (int i = 0; i < n_captures; i++) {
+        picker->scores[i] = score_capture(board, &picker->moves[i]);
+    }
+
+    STATS_TIME(picker->stats, order_time, order_start);
+    picker->n_captures = n_captures;
+    picker->bad_captures = end;
+}
+
+// Generates the quiet moves after the captures and scores them by history and "score_move".
+void gen_picker_quiets(MovePicker* picker) {
+    Board* board = picker->board;
+    int start = picker->n_captures;
+    STATS_START(gen_start);
+    int end = gen_quiet_moves(board, &picker->info, picker->moves, start);
+    STATS_TIME(picker->stats, gen_time, gen_start);
+    STATS_START(order_start);
+    for (int i = start; i < end; i++) {
+        Move* quiet = &picker->moves[i];
+        picker->scores[i] = picker->history[quiet->from][quiet->to] + score_move(board, quiet, &picker->info);
+    }
+    STATS_TIME(picker->stats, order_time, order_start);
+    picker->n_moves = end;
+}
+
+// Killers and the countermove are tried before the other quiet moves.
+bool is_refutation(MovePicker* picker, Move* move) {
+    return SAME_MOVE(*move, picker->killers[0]) || SAME_MOVE(*move, picker->killers[1]) || SAME_MOVE(*move, picker->countermove);
+}
+
+// Selects the highest scoring remaining move of the current stage.
+Move pick_move(MovePicker* picker) {
+    int best = picker->index;
+    for (int i = picker->index + 1; i < picker->end; i++) {
+        if (picker->scores[i] > picker->scores[best]) best = i;
+    }
+
+    Move move = picker->moves[best];
+    int score = picker->scores[best];
+    picker->moves[best] = picker->moves[picker->index];
+    picker->scores[best] = picker->scores[picker->index];
+    picker->moves[picker->index] = move;
+    picker->scores[picker->index] = score;
+    picker->index++;
+
+    return move;
+}
+
+// Most valuable victim, least valuable attacker.
+int score_capture(Board* board, Move* move) {
+    Piece attacker = board->positions[move->from];
+    Piece victim = IS_EN_PASSANT(move->flags) ? PAWN : board->positions[move->to];
+    return PIECE_VALUES[victim] * CAPTURE_BONUS - PIECE_VALUES[attacker] + PIECE_VALUES[PROMOTED_PIECE(move->flags)];
+}
+
+// Taking a piece at least as valuable as the capturing one never loses material, so the exchange only
+// has to be resolved for the remaining captures.
+bool is_losing_capture(Board* board, Move* move) {
+    Piece attacker = board->positions[move->from];
+    Piece victim = IS_EN_PASSANT(move->flags) ? PAWN : board->positions[move->to];
+    if (PIECE_VALUES[victim] >= PIECE_VALUES[attacker]) return false;
+    return see(board, move) < 0;
 }
\ No newline at end of file
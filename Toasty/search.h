@@ -3,27 +3,341 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include "board.h"
 #include "move.h"
 #include "hashmap.h"
 #include "tinycthread.h"
+#include "timer.h"
 
-#define MIN(a, b) (((a) < (b)) ? (a) : (b))
-#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+// Milliseconds the game spends searching each move.
+#define SEARCH_TIME 1000
 
-#define SEARCH_TIMEOUT 1
+// Number of threads searching each move in the game.
+#define SEARCH_THREADS 1
 
 #define INF (1 << 25)
 
-int timer(void* arg);
-void start_timer(bool* stop);
+#define MAX_PLY 128
 
-bool select_move(Board* board, HashMap* hashmap, Move* move);
+// Root search algorithms.
+#define DRIVER_MTDF 0
+#define DRIVER_PVS 1
 
-int search_moves(Board* board, bool* stop, HashMap* hashmap, int depth, int alpha, int beta, Move* selected);
-int alpha_beta(Board* board, bool* stop, HashMap* hashmap, int depth, int ply, int alpha, int beta);
-int quiescence(Board* board, int alpha, int beta);
+// Half width of the first aspiration window, and the depth from which aspiration windows are used.
+#define ASPIRATION_WINDOW 25
+#define ASPIRATION_DEPTH 4
 
+// Late move reductions can be disabled at compile time to measure their effect.
+#ifndef LATE_MOVE_REDUCTIONS
+#define LATE_MOVE_REDUCTIONS 1
+#endif
+
+// Late move reduction table parameters. Moves are reduced from LMR_DEPTH onwards once LMR_MOVES
+// moves have been searched, and every LMR_HISTORY_DIVISOR points of history change the reduction by one ply.
+#define LMR_BASE 0.75
+#define LMR_DIVISOR 2.25
+#define LMR_DEPTH 3
+#define LMR_MOVES 3
+#define LMR_HISTORY_DIVISOR 8192
+
+// Forward pruning techniques, each of which can be disabled at compile time.
+#ifndef REVERSE_FUTILITY_PRUNING
+#define REVERSE_FUTILITY_PRUNING 1
+#endif
+#ifndef FUTILITY_PRUNING
+#define FUTILITY_PRUNING 1
+#endif
+#ifndef RAZORING
+#define RAZORING 1
+#endif
+#ifndef LATE_MOVE_PRUNING
+#define LATE_MOVE_PRUNING 1
+#endif
+
+// Forward pruning is applied up to the given remaining depth, with margins per ply of depth.
+#define RFP_DEPTH 6
+#define RFP_MARGIN 120
+#define FUTILITY_DEPTH 2
+#define FUTILITY_MARGIN 200
+#define RAZOR_DEPTH 2
+#define RAZOR_MARGIN 300
+// At most LMP_BASE + depth^2 moves are searched before late quiet moves are pruned.
+#define LMP_DEPTH 3
+#define LMP_BASE 3
+
+// Null moves are searched from NULL_MOVE_DEPTH with a reduction of at least NULL_MOVE_REDUCTION, one more
+// ply for every 4 plies of depth and for every NULL_MOVE_MARGIN the static evaluation exceeds beta by.
+// Cutoffs from NULL_VERIFY_DEPTH onwards are verified with a search without null moves.
+#define NULL_MOVE_DEPTH 2
+#define NULL_MOVE_REDUCTION 2
+#define NULL_MOVE_MARGIN 200
+#define NULL_VERIFY_DEPTH 8
+
+// The move picker generates each stage of moves only once the previous stages have not caused a cutoff.
+// Compile with STAGED_MOVE_GENERATION=0 to generate and score all moves before the hash move is tried,
+// as before the move picker, which measures what the lazy stages save.
+#ifndef STAGED_MOVE_GENERATION
+#define STAGED_MOVE_GENERATION 1
+#endif
+
+// Captures in quiescence are pruned when they cannot bring the score within DELTA_MARGIN of alpha.
+#ifndef DELTA_PRUNING
+#define DELTA_PRUNING 1
+#endif
+#define DELTA_MARGIN 200
+
+// Number of static evaluations each thread caches, a power of 2.
+#define EVAL_CACHE_SIZE (1 << 14)
+
+// Search statistics are only collected when compiled with SEARCH_STATS=1, and cost nothing otherwise.
+#ifndef SEARCH_STATS
+#define SEARCH_STATS 0
+#endif
+
+#if SEARCH_STATS
+#define STATS_ADD(stats, field, n) ((stats)->field += (n))
+#define STATS_START(start) uint64_t start = get_ticks()
+#define STATS_TIME(stats, field, start) ((stats)->field += get_ticks() - (start))
+#else
+#define STATS_ADD(stats, field, n) ((void) 0)
+#define STATS_START(start) ((void) 0)
+#define STATS_TIME(stats, field, start) ((void) 0)
+#endif
+
+// Beta cutoffs are counted separately for the first moves of a node, the last counter includes all later moves.
+#define STATS_CUTOFF_MOVES 8
+
+// The stop flag of a search is set from other threads, so it is read and written atomically.
+#define STOPPED(search) __atomic_load_n((search)->stop, __ATOMIC_RELAXED)
+#define STOP(stop) __atomic_store_n((stop), true, __ATOMIC_RELAXED)
+
+// Scores beyond this bound are forced mates.
+#define MATE_BOUND (CHECKMATE - MAX_PLY)
+
+// Move picker stages, in the order moves are returned.
+#define STAGE_HASH_MOVE 0
+#define STAGE_GEN_CAPTURES 1
+#define STAGE_GOOD_CAPTURES 2
+#define STAGE_KILLERS 3
+#define STAGE_GEN_QUIETS 4
+#define STAGE_QUIETS 5
+#define STAGE_BAD_CAPTURES 6
+#define STAGE_DONE 7
+
+// History scores are kept within [-HISTORY_MAX, HISTORY_MAX].
+#define HISTORY_MAX 16384
+#define HISTORY_BONUS_MAX 1024
+
+// Side index of a color, used for tables indexed by the side to move.
+#define SIDE(x) ((x) & 1)
+
+// Nodes cut by each forward pruning technique.
+typedef struct {
+    uint64_t reverse_futility;
+    uint64_t futility; // Moves skipped.
+    uint64_t razoring;
+    uint64_t late_move; // Moves skipped.
+} PruneCounts;
+
+// Counters of one search thread, to tell where the search spends its effort.
+typedef struct {
+    uint64_t nodes;
+    uint64_t qnodes;
+    uint64_t tt_probes;
+    uint64_t tt_hits; // Probes that returned a usable bound or a move.
+    uint64_t tt_cutoffs;
+    uint64_t null_move_tries;
+    uint64_t null_move_cutoffs;
+    uint64_t beta_cutoffs[STATS_CUTOFF_MOVES]; // Indexed by the number of the move that caused the cutoff.
+    uint64_t researches; // Searches repeated with a wider window or at full depth.
+    uint64_t gen_time; // Nanoseconds spent generating moves, including the attack maps of "gen_position_info".
+    uint64_t order_time; // Nanoseconds spent scoring and sorting moves.
+    uint64_t eval_time; // Nanoseconds spent in "evaluate".
+    uint64_t magic_lookups; // Sliding attacks looked up in the magic tables.
+} SearchStats;
+
+// Statistics of a finished search, summed over all threads.
+typedef struct {
+    uint64_t nodes;
+    uint64_t qnodes; // Nodes searched by quiescence, included in "nodes".
+    int depth; // Deepest iteration completed by the main thread.
+    PruneCounts pruned;
+    Move pv[MAX_PLY]; // Principal variation of the deepest iteration, its second move is the expected reply.
+    int pv_length;
+#if SEARCH_STATS
+    SearchStats stats;
+#endif
+} SearchInfo;
+
+typedef struct {
+    uint64_t key;
+    int eval;
+} EvalEntry;
+
+// Progress of a search, reported after every completed iteration.
+typedef struct IterationInfo {
+    int depth;
+    int seldepth; // Deepest ply reached, quiescence included.
+    int score;
+    uint64_t nodes; // Nodes searched by all threads so far.
+    uint64_t nps;
+    int hashfull; // Permille of the transposition table used by this search.
+    uint64_t time; // Milliseconds since the search started.
+    Move pv[MAX_PLY];
+    int pv_length;
+} IterationInfo;
+
+struct Worker;
+struct Engine;
+
+// State shared by every node of one search.
+typedef struct {
+    bool* stop;
+    HashMap* hashmap;
+    uint64_t nodes;
+    uint64_t qnodes;
+    int id; // 0 for the main thread, helper threads are numbered from 1.
+    int driver;
+    int depth; // Deepest iteration completed.
+    PruneCounts pruned;
+    int verify_ply; // Null moves are disabled before this ply while a null move cutoff is verified.
+    TimeManager* time; // Only set for the main thread, which decides when the search stops.
+    SearchLimits* limits; // Only set for the main thread, which reports the progress of the search.
+    struct Worker* workers; // Every thread of the search, only set for the main thread.
+    int threads;
+    int seldepth;
+    Move killers[MAX_PLY][2]; // Quiet moves that caused a beta cutoff at each ply.
+    Move countermoves[64][64]; // Quiet move that refuted the previous move, indexed by its from and to square.
+    int history[2][64][64]; // Butterfly history of quiet moves, indexed by side, from and to square.
+    Move stack[MAX_PLY + 1]; // Move made at each ply, null moves included.
+    Move pv[MAX_PLY + 1][MAX_PLY + 1]; // Triangular table, the principal variation from each ply.
+    int pv_length[MAX_PLY + 1]; // One past the last move of the principal variation from each ply.
+    Move previous_pv[MAX_PLY + 1]; // Principal variation of the last completed iteration.
+    int previous_pv_length;
+    EvalEntry eval_cache[EVAL_CACHE_SIZE];
+#if SEARCH_STATS
+    SearchStats stats;
+#endif
+} Search;
+
+// A thread of a parallel search. Each thread searches its own copy of the board and only
+// shares the transposition table with the other threads.
+typedef struct Worker {
+    Search search;
+    Board board;
+    int id;
+    int max_depth;
+    Move selected;
+    thrd_t thread;
+    struct Engine* engine; // Engine the thread belongs to, if any.
+} Worker;
+
+// Result of a search started with "search_start".
+typedef struct {
+    bool found; // False if the position has no legal moves.
+    Move move;
+    SearchInfo info;
+} SearchResult;
+
+// A search session whose threads stay alive between searches. Searches are started, stopped and
+// collected by the thread that owns the engine, which never blocks unless it calls "search_wait".
+typedef struct Engine {
+    HashMap* hashmap;
+    int threads;
+    Worker* workers; // The first worker is the main thread of every search.
+    Board board; // Position and limits of the current search.
+    SearchLimits limits;
+    bool stop;
+    bool quit;
+    int generation; // Incremented for every search, which wakes up the threads.
+    int running; // Threads still searching, the result is ready once it drops to 0.
+    SearchResult result;
+    mtx_t mutex;
+    cnd_t start; // Signalled when a search starts.
+    cnd_t done; // Signalled when a thread finishes searching.
+} Engine;
+
+// A search on the opponent's time, of the position after the reply the engine expects.
+typedef struct {
+    Engine* engine;
+    Move reply;
+    bool pondering; // Cleared on a ponder hit, which starts the clock of the search.
+} Ponder;
+
+// Yields the moves of a position one at a time, generating and scoring each stage only
+// once the previous stage is exhausted.
+typedef struct {
+    Board* board;
+    PositionInfo info;
+    Move hash_move;
+    Move killers[2];
+    Move countermove;
+    int (*history)[64]; // History of the side to move.
+    Move moves[MAX_MOVES]; // Captures first, followed by quiet moves once generated.
+    int scores[MAX_MOVES];
+    int stage;
+    int index; // Next move to consider in the current stage.
+    int end; // One past the last move of the current stage.
+    int n_captures;
+    int bad_captures; // Index of the first losing capture.
+    int n_moves; // One past the last quiet move once they are generated.
+#if SEARCH_STATS
+    SearchStats* stats;
+#endif
+} MovePicker;
+
+void init_reductions();
+bool select_move(Board* board, HashMap* hashmap, Move* move, SearchLimits* limits, int threads, SearchInfo* info);
+void engine_init(Engine* engine, HashMap* hashmap, int threads);
+void engine_free(Engine* engine);
+void search_start(Engine* engine, Board* board, SearchLimits* limits);
+void search_stop(Engine* engine);
+bool search_ready(Engine* engine);
+void search_wait(Engine* engine, SearchResult* result);
+int engine_worker(void* arg);
+bool ponder_start(Ponder* ponder, Engine* engine, Board* board, Move* reply, SearchLimits* limits);
+bool ponder_hit(Ponder* ponder, Move* played);
+
+void report_iteration(Search* search, int depth, int score);
+#if SEARCH_STATS
+void add_stats(SearchStats* total, SearchStats* stats);
+void print_stats(FILE* file, SearchStats* stats);
+#endif
+void search_init(Search* search, bool* stop, HashMap* hashmap);
+int parallel_search(Board* board, HashMap* hashmap, bool* stop, SearchLimits* limits, int threads, Move* selected, SearchInfo* info);
+void worker_init(Worker* worker, Board* board, bool* stop, HashMap* hashmap, SearchLimits* limits);
+void search_info(Worker* workers, int threads, SearchInfo* info);
+int search_worker(void* arg);
+int iterative_deepening(Search* search, Board* board, int max_depth, Move* selected);
+void count_node(Search* search);
+uint64_t search_nodes(Search* search);
+int mtdf(Search* search, Board* board, int depth, int guess, Move* selected);
+int aspiration(Search* search, Board* board, int depth, int guess, Move* selected);
+int pv_search(Search* search, Board* board, int depth, int ply, int alpha, int beta, bool first);
+int search_moves(Search* search, Board* board, int depth, int alpha, int beta, Move* selected);
+int alpha_beta(Search* search, Board* board, int depth, int ply, int alpha, int beta);
+bool has_non_pawn_material(Board* board);
+int late_move_reduction(MovePicker* picker, Move* move, int depth, int n_moves, int history);
+void update_pv(Search* search, int ply, Move* move);
+bool on_previous_pv(Search* search, int ply);
+int score_to_hashmap(int score, int ply);
+int score_from_hashmap(int score, int ply);
+int quiescence(Search* search, Board* board, int ply, int alpha, int beta);
+int static_evaluation(Search* search, Board* board);
+
+void order_captures(Board* board, Move* moves, int size);
 void order_moves(Board* board, Move* moves, int size);
 
+void update_quiet_stats(Search* search, Board* board, int depth, int ply, Move* move, Move* quiets, int n_quiets);
+void update_history(int* history, int bonus);
+void init_move_picker(MovePicker* picker, Board* board, Move* hash_move, Move* killers, Move* countermove, int (*history)[64]);
+bool is_refutation(MovePicker* picker, Move* move);
+bool next_move(MovePicker* picker, Move* move);
+void gen_picker_captures(MovePicker* picker);
+void gen_picker_quiets(MovePicker* picker);
+Move pick_move(MovePicker* picker);
+int score_capture(Board* board, Move* move);
+bool is_losing_capture(Board* board, Move* move);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "move.h"
+#include "hashmap.h"
+#include "tinycthread.h"
+
+// Every key has its own 16 bit verifier, so a probe may only ever return the data written for that key.
+#define N_KEYS (1 << 16)
+
+typedef struct {
+    HashMap* hashmap;
+    uint64_t seed;
+    int operations;
+    uint64_t hits;
+    uint64_t errors;
+} Worker;
+
+static uint64_t next_random(uint64_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static uint64_t make_key(int i) {
+    return ((uint64_t) i << 48) | (((uint64_t) i * 0x9E3779B97F4A7C15ULL) >> 16);
+}
+
+// The value, depth, bound and move stored for a key are all derived from it, so mixing the fields
+// of two different writes is detected.
+static int key_value(int i) { return (i * 7919) % 30000 - 15000; }
+static int key_depth(int i) { return i % 100; }
+static int key_flag(int i) { return 1 + i % 3; }
+static Move key_move(int i) {
+    Move move;
+    move.from = i % 64;
+    move.to = (move.from + 1 + (i / 64) % 63) % 64;
+    move.flags = ADD_PROMOTED_PIECE(i % 7 == 0 ? QUEEN : EMPTY);
+    return move;
+}
+
+static int stress(void* arg) {
+    Worker* worker = (Worker*) arg;
+    uint64_t state = worker->seed;
+
+    for (int n = 0; n < worker->operations; n++) {
+        uint64_t random = next_random(&state);
+        int i = random % N_KEYS;
+        uint64_t key = make_key(i);
+
+        if ((random >> 32) & 1) {
+            Move move = key_move(i);
+            hashmap_set(worker->hashmap, key, key_value(i), key_depth(i), key_flag(i), &move);
+            continue;
+        }
+
+        int value;
+        Move move = {0, 0, 0};
+        int flag = hashmap_get(worker->hashmap, key, 0, &value, &move);
+        if (IS_NULL_MOVE(move)) continue;
+
+        worker->hits++;
+        Move expected = key_move(i);
+        if (!SAME_MOVE(move, expected) || flag != key_flag(i) || value != key_value(i)) {
+            worker->errors++;
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char* args[]) {
+    int threads = argc > 1 ? atoi(args[1]) : 8;
+    int operations = argc > 2 ? atoi(args[2]) : 10000000;
+
+    // A small table so that threads constantly overwrite each other's entries.
+    HashMap* hashmap = hashmap_alloc(12);
+
+    Worker* workers = (Worker*) calloc(threads, sizeof(Worker));
+    thrd_t* handles = (thrd_t*) malloc(threads * sizeof(thrd_t));
+    for (int i = 0; i < threads; i++) {
+        workers[i].hashmap = hashmap;
+        workers[i].seed = 0x2545F4914F6CDD1DULL * (i + 1);
+        workers[i].operations = operations;
+        thrd_create(&handles[i], stress, &workers[i]);
+    }
+
+    uint64_t hits = 0;
+    uint64_t errors = 0;
+    for (int i = 0; i < threads; i++) {
+        thrd_join(handles[i], NULL);
+        hits += workers[i].hits;
+        errors += workers[i].errors;
+    }
+
+    printf("%d threads, %d operations each: %llu hits, %llu inconsistent entries\n", threads, operations, hits, errors);
+
+    free(handles);
+    free(workers);
+    hashmap_free(hashmap);
+
+    return errors == 0 ? 0 : 1;
+}
\ No newline at end of file
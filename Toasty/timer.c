@@ -0,0 +1,108 @@
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+#include "move.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// Milliseconds from a monotonic clock, unaffected by changes to the system time.
+uint64_t get_time() {
+#if defined(_WIN32)
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart * 1000 / frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+#endif
+}
+
+// Nanoseconds from a monotonic clock, for measuring short intervals.
+uint64_t get_ticks() {
+#if defined(_WIN32)
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart / frequency.QuadPart * 1000000000 + counter.QuadPart % frequency.QuadPart * 1000000000 / frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+#endif
+}
+
+void time_manager_init(TimeManager* time, SearchLimits* limits) {
+    time->start = get_time();
+    time->nodes = limits->nodes;
+    time->timed = true;
+    time->best = (Move) {0, 0, 0};
+    time->stable = 0;
+    time->ponder = limits->ponder;
+
+    if (limits->movetime > 0) {
+        // The next iteration usually takes longer than all previous ones combined, so it is not
+        // worth starting one past half of the time.
+        time->hard = limits->movetime;
+        time->soft = limits->movetime / 2;
+    } else if (limits->time > 0) {
+        // Both are converted once so the limits below are computed without mixing signed and unsigned.
+        uint64_t remaining = limits->time;
+        uint64_t increment = MAX(limits->increment, 0);
+        uint64_t budget = remaining / MOVES_TO_GO + increment * 3 / 4;
+        time->soft = budget;
+        // Never use more than a quarter of the remaining time on one move.
+        time->hard = MIN(budget * 4, remaining / 4);
+        if (time->soft > time->hard) time->soft = time->hard;
+    } else {
+        time->timed = false;
+        time->soft = UINT64_MAX;
+        time->hard = UINT64_MAX;
+    }
+}
+
+uint64_t time_elapsed(TimeManager* time) {
+    return get_time() - time->start;
+}
+
+// Whether the search is still pondering. The ponder flag is cleared by another thread on a ponder hit,
+// from which point on the search is timed as if it had just started.
+bool time_pondering(TimeManager* time) {
+    if (time->ponder == NULL) return false;
+    if (__atomic_load_n(time->ponder, __ATOMIC_ACQUIRE)) return true;
+    time->ponder = NULL;
+    time->start = get_time();
+    return false;
+}
+
+// Checked while searching, every POLL_NODES nodes.
+bool time_up(TimeManager* time, uint64_t nodes) {
+    if (time_pondering(time)) return false;
+    if (time->nodes > 0 && nodes >= time->nodes) return true;
+    return time->timed && time_elapsed(time) >= time->hard;
+}
+
+// Called after every completed iteration with its best move. Returns whether another iteration
+// should be started. The more iterations the best move has survived, the sooner the search ends.
+bool time_next_iteration(TimeManager* time, Move* best) {
+    if (SAME_MOVE(*best, time->best)) {
+        time->stable++;
+    } else {
+        time->best = *best;
+        time->stable = 0;
+    }
+
+    if (time_pondering(time) || !time->timed) return true;
+
+    uint64_t soft = time->soft;
+    if (time->stable >= STABLE_ITERATIONS) {
+        soft /= 2;
+    }
+
+    return time_elapsed(time) < soft;
+}
\ No newline at end of file
@@ -0,0 +1,56 @@
+#ifndef TIMER_H_
+#define TIMER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "move.h"
+
+// Nodes searched between checks of the clock.
+#define POLL_NODES 1024
+
+// Share of the remaining clock time used for one move when no move time is given.
+#define MOVES_TO_GO 30
+
+// Iterations the best move has to stay the same before the search may stop early.
+#define STABLE_ITERATIONS 3
+
+struct IterationInfo;
+
+// Limits of a search. Unused limits are 0.
+typedef struct {
+    int time; // Time left on the clock in milliseconds.
+    int increment; // Increment per move in milliseconds.
+    int movetime; // Time for this move in milliseconds.
+    int depth;
+    // Nodes searched by all threads together. Checked every POLL_NODES nodes of the main thread, so it
+    // may be exceeded by about POLL_NODES nodes per thread.
+    uint64_t nodes;
+    int driver; // Root search algorithm, MTD(f) by default.
+    bool* ponder; // While set, the search ignores its limits. They apply from the moment it is cleared.
+    // Called by the main thread after every completed iteration, with "data" passed along.
+    void (*on_iteration)(struct IterationInfo* info, void* data);
+    void* data;
+} SearchLimits;
+
+// Deadlines of one search, measured in milliseconds from its start.
+typedef struct {
+    uint64_t start;
+    uint64_t soft; // No new iteration is started past this point.
+    uint64_t hard; // The search is stopped at this point, even in the middle of an iteration.
+    uint64_t nodes;
+    bool timed;
+    Move best; // Best move of the last completed iteration.
+    int stable; // Number of iterations in a row the best move did not change.
+    bool* ponder; // Cleared once the search stops pondering.
+} TimeManager;
+
+uint64_t get_time();
+uint64_t get_ticks();
+
+void time_manager_init(TimeManager* time, SearchLimits* limits);
+uint64_t time_elapsed(TimeManager* time);
+bool time_pondering(TimeManager* time);
+bool time_up(TimeManager* time, uint64_t nodes);
+bool time_next_iteration(TimeManager* time, Move* best);
+
+#endif
\ No newline at end of file
@@ -35,6 +35,8 @@ private:
 
 	Board* chessboard;
 	HashMap* table;
+	Engine engine; // Searches in the background, only touched from the GUI thread.
+	SearchLimits limits;
 
 	std::unordered_map<byte, std::unordered_map<byte, olc::Decal*>> pieces;
 	std::vector<int> audio;
@@ -63,6 +65,8 @@ private:
 	Piece winner; // WHITE, BLACK, or DRAW.
 
 	bool waiting; // Waiting for the AI to select a move.
+	bool pondering; // Searching the player's expected move while the player thinks.
+	Ponder ponder;
 	Piece ai_color;
 
 	// Used to track duplicate move destination spots to avoid redrawing circles.
@@ -138,6 +142,7 @@ public:
 		winner = 0;
 
 		waiting = false;
+		pondering = false;
 		ai_color = BLACK;
 		
 		selectedSource = -1;
@@ -146,7 +151,12 @@ public:
 		chessboard = new Board();
 		board_from_fen(chessboard, BOARD_STATE);
 		init_magic_tables();
-		table = hashmap_alloc(20);
+		init_reductions();
+		table = hashmap_alloc(21);
+		engine_init(&engine, table, SEARCH_THREADS);
+		limits = {};
+		limits.movetime = SEARCH_TIME;
+		limits.driver = DRIVER_PVS;
 
 		DrawBoard();
 		GenerateMoves();
@@ -174,6 +184,9 @@ public:
 		DrawPieces();
 
 		if (waiting) {
+			if (search_ready(&engine)) {
+				FinishMove();
+			}
 			return true;
 		}
 
@@ -245,6 +258,7 @@ public:
 
 	bool OnUserDestroy() {
 		olc::SOUND::DestroyAudio();
+		engine_free(&engine);
 		delete chessboard;
 		hashmap_free(table);
 
@@ -283,39 +297,50 @@ public:
 		make_move(chessboard, move);
 
 		if (ENABLE_AI) {
-			std::thread thread = std::thread([this] {
-				waiting = true;
-
-				// Then the computer selects a move.
-				Move selected;
-				Board copy = *chessboard;
-
-				if (select_move(&copy, table, &selected)) {
-					make_move(chessboard, &selected);
-					if (IS_CAPTURE(selected.flags) || IS_CASTLE(selected.flags)) {
-						olc::SOUND::PlaySample(audio[CAPTURE_AUDIO]);
-					} else {
-						olc::SOUND::PlaySample(audio[MOVE_AUDIO]);
-					}
-					// Highlight the source and destination squares of the most recently made move.
-					olc::vi2d rfs = Itov(selected.from), rfd = Itov(selected.to);
-					FillRect({unit * rfs.x + unit, unit * rfs.y + unit}, {unit, unit}, highlightEnemy);
-					FillRect({unit * rfd.x + unit, unit * rfd.y + unit}, {unit, unit}, highlightEnemy);
-				} else {
-					gameOver = true;
-					olc::SOUND::PlaySample(audio[END_AUDIO]);
-				}
-
-				// Then all possible moves are generated for the player.
-				GenerateMoves();
+			// Then the computer searches for a move in the background. If the player made the expected
+			// move, the search already under way continues.
+			if (!pondering || !ponder_hit(&ponder, move)) {
+				search_start(&engine, chessboard, &limits);
+			}
+			pondering = false;
+			waiting = true;
+		} else {
+			GenerateMoves();
+		}
+	}
 
-				waiting = false;
-			});
+	// Make the move the computer selected, once its search has finished.
+	void FinishMove() {
+		SearchResult result;
+		search_wait(&engine, &result);
 
-			thread.detach();
+		if (result.found) {
+			Move selected = result.move;
+			make_move(chessboard, &selected);
+			if (IS_CAPTURE(selected.flags) || IS_CASTLE(selected.flags)) {
+				olc::SOUND::PlaySample(audio[CAPTURE_AUDIO]);
+			} else {
+				olc::SOUND::PlaySample(audio[MOVE_AUDIO]);
+			}
+			// Highlight the source and destination squares of the most recently made move.
+			olc::vi2d rfs = Itov(selected.from), rfd = Itov(selected.to);
+			FillRect({unit * rfs.x + unit, unit * rfs.y + unit}, {unit, unit}, highlightEnemy);
+			FillRect({unit * rfd.x + unit, unit * rfd.y + unit}, {unit, unit}, highlightEnemy);
+
+			// Keep searching on the player's time, assuming they reply as predicted by the search.
+			SearchInfo* info = &result.info;
+			if (info->pv_length > 1 && SAME_MOVE(info->pv[0], selected)) {
+				pondering = ponder_start(&ponder, &engine, chessboard, &info->pv[1], &limits);
+			}
 		} else {
-			GenerateMoves();
+			gameOver = true;
+			olc::SOUND::PlaySample(audio[END_AUDIO]);
 		}
+
+		// Then all possible moves are generated for the player.
+		GenerateMoves();
+
+		waiting = false;
 	}
 
 	// Make a move to the selected destination on the GUI.